@@ -0,0 +1,231 @@
+/*
+ *
+ */
+
+// Microbenchmarks of the string and UTF-8 functions hc calls for every row of every frame.
+// ./bench [filter] writes JSON to stdout and a summary to stderr, see docs/README.md.
+#include "gt.h"
+
+#define BENCH_REPS        10    // timed repetitions, the median is reported
+#define BENCH_WARMUP_MS   20    // each benchmark runs untimed first, also to size its repetitions
+#define BENCH_REP_MS      10    // aimed duration of one repetition
+
+/* ------------------------------------------------------------------------- */
+// allocations: with BENCH_COUNT_ALLOCS the Makefile links with --wrap, so every allocation libgt makes passes here
+static size_t benchAllocs = 0;
+
+#ifdef BENCH_COUNT_ALLOCS
+void *__real_malloc( size_t size );
+void *__real_calloc( size_t count, size_t size );
+void *__real_realloc( void *pointer, size_t size );
+char *__real_strdup( const char *string );
+
+void *__wrap_malloc( size_t size )
+{
+   benchAllocs++;
+   return __real_malloc( size );
+}
+
+void *__wrap_calloc( size_t count, size_t size )
+{
+   benchAllocs++;
+   return __real_calloc( count, size );
+}
+
+void *__wrap_realloc( void *pointer, size_t size )
+{
+   benchAllocs++;
+   return __real_realloc( pointer, size );
+}
+
+char *__wrap_strdup( const char *string )
+{
+   benchAllocs++;
+   return __real_strdup( string );
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+// inputs: a pattern repeated up to the size, cut at a whole pattern character, then "|end" for gt_at() to find.
+// Every unit of the pathological pattern is decoded by its lead byte alone, so no read runs past the end.
+typedef struct
+{
+   const char *name;
+   const char *units[ 8 ];  // NULL terminated, the string is cut between two units only
+} BenchPattern;
+
+static const BenchPattern benchPatterns[] =
+{
+   { "ascii",         { "The ", "quick ", "brown ", "fox ", "jumps ", "over ", "the lazy dog. ", NULL } },
+   { "latin",         { "Zażółć ", "gęślą ", "jaźń, ", "Ærøskøbing, ", "naïve ", "café. ", NULL } },
+   { "cjk",           { "日本語", "の", "テキスト", "、", "中文", "文本。", NULL } },
+   { "pathological",  { "\x80", "\xFF", "\xC3(", "\xE2\x82" "a", "\xF0\x9F\x98\x80", "\xF0" "abc", NULL } },
+};
+
+static const size_t benchSizes[] = { 16, 256, 4096, 65536, 1048576 };
+
+static char *bench_input( const BenchPattern *pattern, size_t size )
+{
+   const char *tail = "|end";
+   size_t fill = size - strlen( tail );
+   size_t length = 0;
+
+   char *input = malloc( size + 1 );
+   if( !input )
+   {
+      return NULL;
+   }
+
+   for( int u = 0; ; u = pattern->units[ u + 1 ] ? u + 1 : 0 )
+   {
+      size_t unit = strlen( pattern->units[ u ] );
+      if( length + unit > fill )
+      {
+         break;
+      }
+      memcpy( input + length, pattern->units[ u ], unit );
+      length += unit;
+   }
+   strcpy( input + length, tail );
+   return input;
+}
+
+/* ------------------------------------------------------------------------- */
+// benchmarks: one call of the function on the input, its result freed
+typedef struct
+{
+   const char *input;
+   int         chars;   // gt_utf8Len( input )
+} BenchArgs;
+
+static volatile size_t benchSink;  // keeps results alive, so calls are not optimized away
+
+static void bench_utf8Len( const BenchArgs *a )      { benchSink += gt_utf8Len( a->input ); }
+static void bench_utf8CharPtrAt( const BenchArgs *a ) { benchSink += ( size_t ) gt_utf8CharPtrAt( a->input, a->chars / 2 ); }
+static void bench_at( const BenchArgs *a )           { benchSink += gt_at( "|end", a->input ); }
+
+static void bench_keep( char *result )
+{
+   benchSink += result ? ( unsigned char ) result[ 0 ] : 0;
+   free( result );
+}
+
+static void bench_subStr( const BenchArgs *a ) { bench_keep( gt_subStr( a->input, a->chars / 4, a->chars / 2 ) ); }
+static void bench_padL( const BenchArgs *a )   { bench_keep( gt_padL( a->input, a->chars + 16 ) ); }
+static void bench_padC( const BenchArgs *a )   { bench_keep( gt_padC( a->input, a->chars + 16 ) ); }
+static void bench_padR( const BenchArgs *a )   { bench_keep( gt_padR( a->input, a->chars + 16 ) ); }
+static void bench_left( const BenchArgs *a )   { bench_keep( gt_left( a->input, a->chars / 2 ) ); }
+static void bench_right( const BenchArgs *a )  { bench_keep( gt_right( a->input, a->chars / 2 ) ); }
+static void bench_addStr( const BenchArgs *a ) { bench_keep( gt_addStr( a->input, " / ", a->input, NULL ) ); }
+
+typedef struct
+{
+   const char *name;
+   void ( *run )( const BenchArgs *args );
+} Benchmark;
+
+static const Benchmark benchmarks[] =
+{
+   { "gt_utf8Len",       bench_utf8Len },
+   { "gt_utf8CharPtrAt", bench_utf8CharPtrAt },
+   { "gt_subStr",        bench_subStr },
+   { "gt_padL",          bench_padL },
+   { "gt_padC",          bench_padC },
+   { "gt_padR",          bench_padR },
+   { "gt_left",          bench_left },
+   { "gt_right",         bench_right },
+   { "gt_addStr",        bench_addStr },
+   { "gt_at",            bench_at },
+};
+
+/* ------------------------------------------------------------------------- */
+static double bench_ms( Uint64 from, Uint64 to )
+{
+   return ( double )( to - from ) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static int bench_compareDouble( const void *a, const void *b )
+{
+   double x = *( const double * ) a;
+   double y = *( const double * ) b;
+   return ( x > y ) - ( x < y );
+}
+
+// Warm-up sizes the repetitions, then the median and the fastest of BENCH_REPS repetitions are reported
+static void bench_run( const Benchmark *benchmark, const BenchPattern *pattern, size_t size, const BenchArgs *args, bool first )
+{
+   Uint64 ops = 0;
+   Uint64 start = SDL_GetPerformanceCounter();
+   do
+   {
+      benchmark->run( args );
+      ops++;
+   }
+   while( bench_ms( start, SDL_GetPerformanceCounter() ) < BENCH_WARMUP_MS );
+
+   Uint64 perRep = MAX( ( Uint64 )( ops * BENCH_REP_MS / BENCH_WARMUP_MS ), ( Uint64 ) 1 );
+   double nsPerOp[ BENCH_REPS ];
+
+   size_t allocs = benchAllocs;
+   for( int r = 0; r < BENCH_REPS; r++ )
+   {
+      start = SDL_GetPerformanceCounter();
+      for( Uint64 o = 0; o < perRep; o++ )
+      {
+         benchmark->run( args );
+      }
+      nsPerOp[ r ] = bench_ms( start, SDL_GetPerformanceCounter() ) * 1000000.0 / perRep;
+   }
+   allocs = benchAllocs - allocs;
+
+   qsort( nsPerOp, BENCH_REPS, sizeof( double ), bench_compareDouble );
+   double median = ( nsPerOp[ ( BENCH_REPS - 1 ) / 2 ] + nsPerOp[ BENCH_REPS / 2 ] ) / 2.0;
+
+   printf( "%s\n    { \"name\": \"%s\", \"input\": \"%s\", \"bytes\": %zu, \"reps\": %d, \"ops_per_rep\": %llu, "
+           "\"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, \"allocs_per_op\": ",
+           first ? "" : ",", benchmark->name, pattern->name, size, BENCH_REPS, ( unsigned long long ) perRep,
+           median, nsPerOp[ 0 ] );
+#ifdef BENCH_COUNT_ALLOCS
+   printf( "%.2f }", ( double ) allocs / ( ( double ) perRep * BENCH_REPS ) );
+#else
+   UNUSED( allocs );
+   printf( "null }" );
+#endif
+
+   fprintf( stderr, "%-18s %-13s %8zu B %14.1f ns/op\n", benchmark->name, pattern->name, size, median );
+}
+
+int main( int argc, char *argv[] )
+{
+   const char *filter = argc > 1 ? argv[ 1 ] : "";
+   bool first = T;
+
+   printf( "{\n  \"benchmarks\": [" );
+
+   for( size_t p = 0; p < LEN( benchPatterns ); p++ )
+   {
+      for( size_t s = 0; s < LEN( benchSizes ); s++ )
+      {
+         char *input = bench_input( &benchPatterns[ p ], benchSizes[ s ] );
+         if( !input )
+         {
+            fprintf( stderr, "Memory allocation failed for benchmark input.\n" );
+            return 1;
+         }
+         BenchArgs args = { input, ( int ) gt_utf8Len( input ) };
+
+         for( size_t b = 0; b < LEN( benchmarks ); b++ )
+         {
+            if( strstr( benchmarks[ b ].name, filter ) )
+            {
+               bench_run( &benchmarks[ b ], &benchPatterns[ p ], benchSizes[ s ], &args, first );
+               first = F;
+            }
+         }
+         free( input );
+      }
+   }
+
+   printf( "\n  ]\n}\n" );
+   return 0;
+}
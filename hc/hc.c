@@ -28,6 +28,7 @@ int main( int argc, char *argv[] )
    int index;
 
    GT *gt = gt_createWindow( 800, 450, "Harbour Commander", "F1F1F1" );
+   gt_setMaxFps( gt, 60 );
 
    lPanel = hc_init();
    rPanel = hc_init();
@@ -65,7 +66,7 @@ int main( int argc, char *argv[] )
    while( !quit )
    {
       SDL_Event event;
-      if( SDL_WaitEvent( &event ) )
+      if( gt_waitEvent( gt, &event ) )
       {
          do
          {
@@ -240,9 +241,15 @@ int main( int argc, char *argv[] )
                      default:
                         break;
                   }
+                  gt_requestRedraw( gt );
                   break;
 
                case SDL_MOUSEWHEEL:
+                  // Ctrl+wheel zooms the window, GT handles it
+                  if( SDL_GetModState() & KMOD_CTRL )
+                  {
+                     break;
+                  }
                   if( event.wheel.y > 0 )
                   {
                      if( aPanel->rowBar > 0 )
@@ -265,34 +272,38 @@ int main( int argc, char *argv[] )
                         ++aPanel->rowNo;
                      }
                   }
+                  gt_requestRedraw( gt );
                   break;
 
                case SDL_MOUSEMOTION:
 
-                  if( FONT_CELL_WIDTH == 0 || FONT_CELL_HEIGHT == 0 )
+                  if( gt_fontCellWidth( gt ) == 0 || gt_fontCellHeight( gt ) == 0 )
                   {
                      fprintf( stderr, "Error: Font not properly loaded, cell size is zero.\n" );
                      break;
                   }
 
-                  int mouseX = gt->mouseX / FONT_CELL_WIDTH;
-                  int mouseY = gt->mouseY / FONT_CELL_HEIGHT;
+                  int mouseX = event.motion.x / gt_fontCellWidth( gt );
+                  int mouseY = event.motion.y / gt_fontCellHeight( gt );
 
+                  // Only a change of the active panel is worth a frame
                   if( mouseX >= lPanel->col && mouseX < ( lPanel->col + lPanel->maxCol ) &&
-                      mouseY >= lPanel->row && mouseY < ( lPanel->row + lPanel->maxRow ) )
+                      mouseY >= lPanel->row && mouseY < ( lPanel->row + lPanel->maxRow ) && aPanel != lPanel )
                   {
                      aPanel = lPanel;
+                     gt_requestRedraw( gt );
                   }
                   else if( mouseX >= rPanel->col && mouseX < ( rPanel->col + rPanel->maxCol ) &&
-                           mouseY >= rPanel->row && mouseY < ( rPanel->row + rPanel->maxRow ) )
+                           mouseY >= rPanel->row && mouseY < ( rPanel->row + rPanel->maxRow ) && aPanel != rPanel )
                   {
                      aPanel = rPanel;
+                     gt_requestRedraw( gt );
                   }
                   break;
 
                case SDL_MOUSEBUTTONDOWN:
 
-                  if( FONT_CELL_WIDTH == 0 || FONT_CELL_HEIGHT == 0 )
+                  if( gt_fontCellWidth( gt ) == 0 || gt_fontCellHeight( gt ) == 0 )
                   {
                      fprintf( stderr, "Error: Font not properly loaded, cell size is zero.\n" );
                      break;
@@ -303,8 +314,8 @@ int main( int argc, char *argv[] )
                      case SDL_BUTTON_LEFT:
                         if( event.button.clicks == 1 )
                         {
-                           int mouseX = gt->mouseX / FONT_CELL_WIDTH;
-                           int mouseY = gt->mouseY / FONT_CELL_HEIGHT;
+                           int mouseX = event.button.x / gt_fontCellWidth( gt );
+                           int mouseY = event.button.y / gt_fontCellHeight( gt );
 
                            int rowIndex = mouseY - 1;
 
@@ -353,6 +364,7 @@ int main( int argc, char *argv[] )
                      default:
                         break;
                   }
+                  gt_requestRedraw( gt );
                   break;
 
                default:
@@ -361,14 +373,19 @@ int main( int argc, char *argv[] )
          }
          while( SDL_PollEvent( &event ) );
       }
-      gt_beginDraw( gt );
 
-         hc_autosize( gt );
-         hc_drawPanel( lPanel );
-         hc_drawPanel( rPanel );
-         hc_drawComdLine( gt, aPanel );
+      // Every queued event has been handled, so a held key costs one frame per refresh, not one per event
+      if( gt_frameDue( gt ) )
+      {
+         gt_beginDraw( gt );
+
+            hc_autosize( gt );
+            hc_drawPanel( lPanel );
+            hc_drawPanel( rPanel );
+            hc_drawComdLine( gt, aPanel );
 
-      gt_endDraw( gt );
+         gt_endDraw( gt );
+      }
    }
 
    hc_saveSettings( gt, lPanel, rPanel, "hc.usr" );
@@ -394,6 +411,8 @@ static HC *hc_init( void )
    memset( hc, 0, sizeof( HC ) );
 
    hc->cmdLine = "";
+   hc->drawnRowNo = -1;
+   hc->drawnRowBar = -1;
 
    hc->isFirstDirectory  = T;
    hc->isHiddenDirectory = F;
@@ -590,10 +609,13 @@ void hc_fetchList( HC *hc, const char *currentDir )
    gt_freeDirectory( hc->files );
    hc->filesCount = 0;
    hc->files = gt_directory( hc->currentDir, &hc->filesCount );
+   hc->drawnRowNo = -1;
 
    if( hc->isFirstDirectory )
    {
+      gt_traceBegin( "qsort", hc->currentDir );
       qsort( hc->files, hc->filesCount, sizeof( FileInfo ), hc_compareFiles );
+      gt_traceEnd();
    }
 }
 
@@ -640,8 +662,13 @@ static void hc_autosize( GT *gt )
    hc_resize( rPanel, maxCol / 2, 0, maxCol / 2, maxRow - 1 );
 }
 
+// Called for every frame, the list is drawn again only when the panel really moved or changed its size
 static void hc_resize( HC *hc, int col, int row, int maxCol, int maxRow )
 {
+   if( hc->col != col || hc->row != row || hc->maxCol != maxCol || hc->maxRow != maxRow )
+   {
+      hc->drawnRowNo = -1;
+   }
    hc->col    = col;
    hc->row    = row;
    hc->maxCol = maxCol;
@@ -655,22 +682,48 @@ static void hc_drawPanel( HC *hc )
    int longestSize = 0;
    int longestAttr = 0;
 
+   gt_traceBegin( "hc_drawPanel", hc->currentDir );
+
    longestName = MAX( longestName, hc_findLongestName( hc ) );
    longestSize = hc_findLongestSize( hc );
    longestAttr = hc_findLongestAttr( hc );
 
    if( aPanel == hc )
    {
-      gt_dispBox( hc->col, hc->row, hc->maxCol, hc->maxRow, BOX_DOUBLE, "F1F1F1/323232" );
+      gt_drawBox( hc->col, hc->row, hc->maxCol, hc->maxRow, &gtBoxDouble, gt_hexColorPair( "F1F1F1/323232" ) );
    }
    else
    {
-      gt_dispBox( hc->col, hc->row, hc->maxCol, hc->maxRow, BOX_SINGLE, "F1F1F1/323232" );
+      gt_drawBox( hc->col, hc->row, hc->maxCol, hc->maxRow, &gtBoxSingle, gt_hexColorPair( "F1F1F1/323232" ) );
+   }
+
+   // Rows still on screen from the last frame are moved instead of rendered again
+   int listRows = hc->maxRow - 2 - hc->row;
+   int scrolled = hc->drawnRowNo - hc->rowNo;
+   bool moved = F;
+   if( hc->drawnRowNo >= 0 && scrolled != 0 && abs( scrolled ) < listRows )
+   {
+      moved = gt_scrollRegion( hc->col + 1, hc->row + 1, hc->maxCol - 2, listRows, scrolled );
    }
 
+   // After a move only the exposed rows and the old and new rows of the selection bar are drawn
+   int barRow    = IIF( aPanel == hc, hc->rowBar, -1 );
+   int oldBarRow = IIF( hc->drawnRowBar >= 0, hc->drawnRowBar + scrolled, -1 );
+   int movedFrom = MAX( scrolled, 0 );
+   int movedTo   = listRows + MIN( scrolled, 0 );
+   hc->drawnRowNo  = hc->rowNo;
+   hc->drawnRowBar = barRow;
+
    i += hc->rowNo;
    for( row = hc->row + 1; row < hc->maxRow -1; row++ )
    {
+      int listRow = row - hc->row - 1;
+      if( moved && listRow >= movedFrom && listRow < movedTo && listRow != barRow && listRow != oldBarRow )
+      {
+         ++i;
+         continue;
+      }
+
       if( i < hc->filesCount )
       {
          const char *paddedString = hc_paddedString( hc, longestName, longestSize, longestAttr,
@@ -680,8 +733,6 @@ static void hc_drawPanel( HC *hc )
                                                      hc->files[ i ].time,
                                                      hc->files[ i ].attr );
 
-         char *paddedResult = gt_padR( paddedString, hc->maxCol - 2 );
-
          const char *selectedColor;
 
          if( aPanel == hc && i == hc->rowBar + hc->rowNo )
@@ -700,9 +751,7 @@ static void hc_drawPanel( HC *hc )
             selectedColor = hc_selectColor( hc->files[ i ].attr, hc->files[ i ].state );
          }
 
-         gt_drawText( hc->col + 1, row, paddedResult, selectedColor );
-
-         free( paddedResult );
+         gt_drawTextClipped( hc->col + 1, row, paddedString, hc->maxCol - 2, T, gt_hexColorPair( selectedColor ) );
 
          ++i;
       }
@@ -711,6 +760,7 @@ static void hc_drawPanel( HC *hc )
          break;
       }
    }
+   gt_traceEnd();
 }
 
 static int hc_findLongestName( HC *hc )
@@ -719,7 +769,7 @@ static int hc_findLongestName( HC *hc )
 
    for( int i = 0; i < hc->filesCount; i++ )
    {
-      int currentNameLength = gt_utf8Len( hc->files[ i ].name );
+      int currentNameLength = gt_utf8Width( hc->files[ i ].name );
       if( currentNameLength > longestName )
       {
          longestName = currentNameLength;
@@ -877,9 +927,9 @@ static const char *hc_paddedString( HC *hc, int longestName, int longestSize, in
 
       int availableWidthForName = hc->maxCol - border - strlen( padLSizeAttrDateTime );
 
-      char *cutName = gt_left( name, availableWidthForName );
+      char *cutName = gt_leftWidth( name, availableWidthForName );
 
-      char *padRName = gt_padR( cutName, availableWidthForName );
+      char *padRName = gt_padRWidth( cutName, availableWidthForName );
 
       snprintf( formattedLine, sizeof( formattedLine ), "%s%s", padRName, padLSizeAttrDateTime );
 
@@ -945,18 +995,14 @@ static void hc_drawComdLine( GT *gt, HC *hc )
    }
 
    const char *currentDir = gt_dirDeleteLastSeparator( hc->currentDir );
-
-   char *combinedDir = gt_addStr( currentDir, promptEnd, NULL );
-   char *cmdLinePart = gt_subStr( hc->cmdLine, 1 + hc->cmdColNo, maxCol + hc->cmdColNo );
-   char *combinedCmdLine = gt_addStr( combinedDir, cmdLinePart, NULL );
-   char *paddedCmdLine = gt_padR( combinedCmdLine, maxCol + 1 );
-
-   gt_drawText( 0, maxRow - 1, paddedCmdLine, "323232/00FF00" );
-
-   free( combinedDir );
-   free( cmdLinePart );
-   free( combinedCmdLine );
-   free( paddedCmdLine );
+   const char *cmdLinePart = gt_utf8CharPtrAt( hc->cmdLine, 1 + hc->cmdColNo );
+   gt_colorPair color = gt_hexColorPair( "323232/00FF00" );
+
+   // The prompt, the visible part of the command line and the blanks after it go straight into the row. The grid has
+   // maxCol + 1 columns when the window width is not a multiple of the cell width, the bar fills that last one as well.
+   int col = gt_drawTextClipped( 0, maxRow - 1, currentDir, maxCol + 1, F, color );
+   col += gt_drawTextClipped( col, maxRow - 1, promptEnd, maxCol + 1 - col, F, color );
+   gt_drawTextClipped( col, maxRow - 1, cmdLinePart, maxCol + 1 - col, T, color );
 }
 
 static void hc_changeDir( HC *hc )
@@ -34,6 +34,8 @@ struct _HC
 
    int         rowBar;
    int         rowNo;
+   int         drawnRowNo;  // rowNo on screen, -1 when the list has to be drawn again
+   int         drawnRowBar; // list row drawn as the selection bar, -1 when none is
 
    const char *cmdLine;
    int         cmdCol;
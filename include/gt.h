@@ -26,8 +26,8 @@
 #define ENCODING          0xFFFE
 #define FONT_CELL_WIDTH   9
 #define FONT_CELL_HEIGHT 18
-
-extern unsigned int gtFontMatrix[ ENCODING ][ FONT_CELL_HEIGHT ];
+#define GT_FONT_MAX_WIDTH  16  // glyph rows are Uint16, most significant bit is the leftmost pixel
+#define GT_FONT_MAX_HEIGHT 64
 
 #define BOX_SINGLE         "┌─┐│┘└"
 #define BOX_DOUBLE         "╔═╗║╝╚"
@@ -41,8 +41,63 @@ typedef enum bool
    T = ( ! 0 )
 } bool;
 
-typedef struct _GT       GT;
-typedef struct _FileInfo FileInfo;
+typedef Uint32 gt_color; // packed 0xRRGGBBAA
+
+typedef struct
+{
+   gt_color bg;
+   gt_color fg;
+} gt_colorPair;
+
+#define GT_RGBA( r, g, b, a ) ( ( gt_color )( ( ( Uint32 )( r ) << 24 ) | ( ( Uint32 )( g ) << 16 ) | ( ( Uint32 )( b ) << 8 ) | ( Uint32 )( a ) ) )
+#define GT_RGB( r, g, b )     GT_RGBA( r, g, b, 255 )
+#define GT_R( color )         ( ( Uint8 )( ( color ) >> 24 ) )
+#define GT_G( color )         ( ( Uint8 )( ( color ) >> 16 ) )
+#define GT_B( color )         ( ( Uint8 )( ( color ) >> 8 ) )
+#define GT_A( color )         ( ( Uint8 )( color ) )
+
+typedef enum
+{
+   GT_RENDERER_DEFAULT = 0,
+   GT_RENDERER_GL_LEGACY,  // fixed function OpenGL, diffed into a canvas framebuffer
+   GT_RENDERER_GL_CORE,    // OpenGL 3.3 core profile, one instanced draw per frame
+   GT_RENDERER_SOFTWARE,   // CPU only, glyphs expanded into a pixel buffer and shown through an SDL surface
+   GT_RENDERER_HEADLESS,   // software renderer without a window, also forced by GT_HEADLESS=1
+   GT_RENDERER_TERMINAL    // no window, the cells are written to stdout as VT escape sequences
+} GTRenderer;
+
+typedef enum
+{
+   GT_SYNC_VSYNC = 0,  // wait for vertical blank
+   GT_SYNC_ADAPTIVE,   // vsync, but late frames tear instead of waiting a whole refresh
+   GT_SYNC_IMMEDIATE   // never wait
+} GTSync;
+
+// OpenGL work timed in GT_GL_DEBUG builds, see gt_getGpuTimes()
+typedef enum
+{
+   GT_GPU_SUBMIT = 0,  // changed cells rendered
+   GT_GPU_BLIT,        // legacy canvas copied to the back buffer
+   GT_GPU_SCROLL,      // pixels moved by gt_scrollRegion(), the last call of the frame
+   GT_GPU_SWAP,        // SDL_GL_SwapWindow()
+   GT_GPU_PHASES
+} GTGpuPhase;
+
+#define GT_MAX_DAMAGE  32
+#define GT_MAX_SCALE   8
+#define GT_MAX_LAYERS  16
+#define GT_MAX_WINDOWS 16
+
+typedef struct _GT             GT;
+typedef struct _GTCell         GTCell;
+typedef struct _GTFont         GTFont;
+typedef struct _GTBox          GTBox;
+typedef struct _GTLayer        GTLayer;
+typedef struct _GTBackend      GTBackend;
+typedef struct _GTRenderThread GTRenderThread;
+typedef struct _GTFrameStats   GTFrameStats;
+typedef struct _GTStats        GTStats;
+typedef struct _FileInfo       FileInfo;
 
 struct _FileInfo
 {
@@ -54,6 +109,82 @@ struct _FileInfo
    bool state;
 };
 
+struct _GTCell
+{
+   unsigned int codepoint;
+   gt_color     fg;
+   gt_color     bg;
+};
+
+// Bitmap font laid out as a sparse page table, see font.c for the cache format
+struct _GTFont
+{
+   int           width;
+   int           height;
+   int           glyphCount;
+   int           fallback;    // glyph drawn for codepoints the font lacks
+   const Uint16 *glyphs;      // glyphCount * height rows
+   const Uint16 *pages;       // 256 entries, block of each 256-codepoint page
+   const Uint16 *blocks;      // glyph index of every codepoint in a block
+   const Uint32 *coverage;    // one bit per codepoint below ENCODING
+   void         *data;        // NULL for the built-in font
+   size_t        size;
+   bool          mapped;
+};
+
+extern const GTFont gtFontBuiltin;
+
+// What one frame cost, see gt_getFrameStats(); percentiles are over the latest frames
+struct _GTFrameStats
+{
+   Uint64 frames;          // frames ended since the window opened
+   double frameMs;         // gt_beginDraw() to the end of gt_endDraw()
+   double cpuMs;           // CPU time the drawing thread spent in the same span
+   int    cellsSubmitted;  // cells in the damage rectangles handed to the renderer
+   int    cellsChanged;    // cells that differ from the frame on screen
+   int    glyphs;          // glyphs the renderer drew, the core profile draws every cell
+   int    glCalls;         // OpenGL draws, uploads and blits
+   size_t bytesUploaded;   // to GL textures and buffers, the window surface or the terminal
+   double frameMsP50;
+   double frameMsP95;
+   double frameMsP99;
+   double cpuMsP50;
+   double cpuMsP95;
+   double cpuMsP99;
+};
+
+// Box characters decoded once, in the order of a BOX_* string
+struct _GTBox
+{
+   unsigned int topLeft;
+   unsigned int horizontal;
+   unsigned int topRight;
+   unsigned int vertical;
+   unsigned int bottomRight;
+   unsigned int bottomLeft;
+};
+
+extern const GTBox gtBoxSingle;
+extern const GTBox gtBoxDouble;
+extern const GTBox gtBoxSingleDouble;
+extern const GTBox gtBoxDoubleSingle;
+
+// Cells drawn over the grid, kept between frames; codepoint 0 is transparent
+struct _GTLayer
+{
+   GT       *gt;
+   int       x;
+   int       y;
+   int       width;
+   int       height;
+   int       z;
+   bool      visible;
+   bool      closed;     // freed by the next frame, after it uncovered the cells below
+   GTCell   *cells;      // width * height
+   GTCell   *under;      // grid cells the layer covered in the last frame, its save-under
+   SDL_Rect  covered;    // where under came from, in grid cells; w = 0 when nothing is covered
+};
+
 struct _GT
 {
    SDL_Window   *window;
@@ -68,19 +199,100 @@ struct _GT
    int           maxCols;
    int           maxRows;
    const char   *background;
+   gt_color      backgroundColor;
+   GTCell       *cells;       // frame being drawn
+   GTCell       *prevCells;   // frame currently on screen
+   int           cellCols;
+   int           cellRows;
+   bool          fullRedraw;
+   GTRenderer    renderer;
+   const GTBackend *backend;    // how frames are rendered, see src/gt_private.h
+   void         *backendData;     // owned by the backend, created by its init and freed by its destroy
+   SDL_Rect      damage[ GT_MAX_DAMAGE ];  // cells changed by the last frame, in cell units
+   int           damageCount;
+   SDL_Rect      scrolled;    // cells moved by gt_scrollRegion() this frame
+   GTLayer      *layers[ GT_MAX_LAYERS ];  // bottom to top
+   int           layerCount;
+   GTLayer      *target;      // layer drawing goes to, NULL for the grid
+   GTRenderThread *renderThread;  // NULL when frames are rendered by gt_endDraw() itself
+   bool          redrawRequested;
+   int           maxFps;      // 0 = no cap
+   Uint64        lastFrame;   // SDL_GetPerformanceCounter() at the end of the last frame
+   const GTFont *font;
+   GTFont       *ownedFont;   // loaded from GT_FONT, freed with the window
+   int           cellWidth;   // drawable pixels, font size times scale
+   int           cellHeight;
+   int           scale;       // integer magnification of the font
+   bool          autoScale;   // follow the display until gt_setScale() or Ctrl+wheel picks a scale
+   int           pixelRatio;  // drawable pixels per window coordinate, 2 on most HiDPI displays
+   GTFrameStats  frameCounts; // what the renderer did for the frame being rendered, only the counters are used
+   GTStats      *stats;       // see gt_getFrameStats(), src/stats.c
 };
 
 /* ------------------------------------------------------------------------- */
 GT  *gt_createWindow( int width, int height, const char *title, const char *hexColor );
+GT  *gt_createWindowEx( int width, int height, const char *title, const char *hexColor, GTRenderer renderer );
 void gt_clearAll( GT *gt );
 void gt_beginDraw( GT *gt );
 void gt_endDraw( GT *gt );
+bool gt_readPixels( GT *gt, int x, int y, int width, int height, gt_color *pixels );
+bool gt_saveFramePPM( GT *gt, const char *path );
+
+/* ------------------------------------------------------------------------- */
+void gt_requestRedraw( GT *gt );
+void gt_setMaxFps( GT *gt, int fps );
+bool gt_setSync( GT *gt, GTSync sync );
+bool gt_frameDue( GT *gt );
+bool gt_startRenderThread( GT *gt );
+void gt_stopRenderThread( GT *gt );
+bool gt_waitEvent( GT *gt, SDL_Event *event );
 
 /* ------------------------------------------------------------------------- */
-SDL_Color gt_hexToColor( const char *hex );
+GTFrameStats gt_getFrameStats( GT *gt );
+bool         gt_exportStats( GT *gt, const char *target );
+bool         gt_getGpuTimes( GT *gt, double phaseMs[ GT_GPU_PHASES ] );
+bool         gt_nextGLMessage( GT *gt, char *message, size_t size );
+
+/* ------------------------------------------------------------------------- */
+bool gt_traceStart( const char *path );
+void gt_traceStop( void );
+void gt_traceBegin( const char *name, const char *detail );
+void gt_traceEnd( void );
+
+/* ------------------------------------------------------------------------- */
+void gt_setScale( GT *gt, int scale );
+int  gt_scale( GT *gt );
+
+/* ------------------------------------------------------------------------- */
+SDL_Color    gt_hexToColor( const char *hex );
+gt_color     gt_hexColor( const char *hexColor );
+gt_colorPair gt_hexColorPair( const char *hexColor );
 
 /* ------------------------------------------------------------------------- */
 void gt_drawText( int x, int y, const char *string, const char *hexColor );
+void gt_drawTextColor( int x, int y, const char *string, gt_colorPair color );
+int  gt_drawTextClipped( int x, int y, const char *string, int maxCols, bool pad, gt_colorPair color );
+void gt_fillRect( int x, int y, int width, int height, unsigned int codepoint, gt_colorPair color );
+void gt_clearRect( int x, int y, int width, int height, gt_colorPair color );
+void gt_drawHLine( int x, int y, int length, unsigned int codepoint, gt_colorPair color );
+void gt_drawVLine( int x, int y, int length, unsigned int codepoint, gt_colorPair color );
+bool gt_scrollRegion( int x, int y, int width, int height, int dy );
+
+/* ------------------------------------------------------------------------- */
+bool     gt_beginOverlay( GT *gt );
+GTLayer *gt_createLayer( GT *gt, int x, int y, int width, int height, int z );
+void     gt_closeLayer( GTLayer *layer );
+void     gt_moveLayer( GTLayer *layer, int x, int y );
+void     gt_showLayer( GTLayer *layer, bool visible );
+void     gt_selectLayer( GT *gt, GTLayer *layer );
+
+/* ------------------------------------------------------------------------- */
+GTFont       *gt_loadFont( const char *path );
+void          gt_freeFont( GTFont *font );
+void          gt_setFont( GT *gt, const GTFont *font );
+bool          gt_glyphExists( const GTFont *font, unsigned int codepoint );
+const Uint16 *gt_glyphLookup( const GTFont *font, unsigned int codepoint );
+
 /* ------------------------------------------------------------------------- */
 int gt_maxCol( GT *gt );
 int gt_maxRow( GT *gt );
@@ -101,6 +313,11 @@ char *gt_space( int count );
 void  gt_safeCopy( char *dest, const char *src, size_t destSize );
 void  gt_safeCopyUtf8( char *dest, const char *src, size_t destSize );
 char *gt_subStr( const char *string, int start, int count );
+char *gt_leftWidth( const char *string, int columns );
+char *gt_padLWidth( const char *string, int columns );
+char *gt_padCWidth( const char *string, int columns );
+char *gt_padRWidth( const char *string, int columns );
+char *gt_subStrWidth( const char *string, int start, int count );
 bool  gt_runApp( const char *commandLine );
 bool  gt_run( const char *commandLine );
 bool  gt_isExecutable( const char *filePath );
@@ -109,12 +326,17 @@ const char *gt_os( void );
 
 /* ------------------------------------------------------------------------- */
 void gt_dispBox( int x, int y, int width, int height, const char *boxString, const char *hexColor );
+void gt_dispBoxColor( int x, int y, int width, int height, const char *boxString, gt_colorPair color );
+bool gt_boxDecode( const char *boxString, GTBox *box );
+void gt_drawBox( int x, int y, int width, int height, const GTBox *box, gt_colorPair color );
 
 /* ------------------------------------------------------------------------- */
 void        gt_Utf8CharExtract( const char *source, char *dest, size_t *index );
 const char *gt_utf8CharPtrAt( const char *string, int characterOffset );
 size_t      gt_utf8Len( const char *utf8String );
 size_t      gt_utf8LenUpTo( const char *utf8String, const char *endPosition );
+int         gt_charWidth( unsigned int codepoint );
+size_t      gt_utf8Width( const char *utf8String );
 
 /* ------------------------------------------------------------------------- */
 const char *gt_cwd( void );
@@ -124,6 +346,9 @@ const char *gt_dirDeleteLastPath( const char *path );
 const char *gt_dirDeleteLastSeparator( const char *path );
 const char *gt_dirLastName( const char *path );
 void        gt_convertToSystemPath( char *path );
+const char *gt_cacheDir( void );
+void       *gt_mapFile( const char *path, size_t *size );
+void        gt_unmapFile( void *data, size_t size );
 /* ------------------------------------------------------------------------- */
 FileInfo   *gt_directory( const char *currentDir, int *size );
 void        gt_freeDirectory( FileInfo *pFiles );
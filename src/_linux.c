@@ -2,7 +2,7 @@
  *
  */
 
-#include "gt.h"
+#include "gt_private.h"
 
 /* ------------------------------------------------------------------------- */
 const char *gt_os( void )
@@ -15,7 +15,7 @@ const char *gt_pathSeparator( void )
    return "/";
 }
 
-FileInfo *gt_directory( const char *currentDir, int *size )
+static FileInfo *gt_readDirectory( const char *currentDir, int *size )
 {
    FileInfo *files = NULL;
    int count = 0;
@@ -55,6 +55,7 @@ FileInfo *gt_directory( const char *currentDir, int *size )
       // Get file information using stat
       if( stat( fullPath, &fileInfo ) == -1 )
       {
+         GT_PROBE2( stat_failed, fullPath, errno );
          perror( "Error getting file info" );
          continue;
       }
@@ -118,6 +119,16 @@ FileInfo *gt_directory( const char *currentDir, int *size )
    return files;
 }
 
+FileInfo *gt_directory( const char *currentDir, int *size )
+{
+   GT_PROBE1( directory_begin, currentDir );
+   gt_traceBegin( "gt_directory", currentDir );
+   FileInfo *files = gt_readDirectory( currentDir, size );
+   gt_traceEnd();
+   GT_PROBE2( directory_end, currentDir, files ? *size : -1 );
+   return files;
+}
+
 void gt_freeDirectory( FileInfo *files )
 {
    if( files )
@@ -141,7 +152,11 @@ bool gt_runApp( const char *commandLine )
 
    snprintf( command, sizeof( command ), "%s", commandLine );
 
+   GT_PROBE1( launch_begin, commandLine );
+   gt_traceBegin( "gt_runApp", commandLine );
    int result = system( command );
+   gt_traceEnd();
+   GT_PROBE2( launch_end, commandLine, result );
    if( result != 0 )
    {
       fprintf( stderr, "Failed to run executable \n" );
@@ -166,7 +181,11 @@ bool gt_run( const char *commandLine )
 
    snprintf( command, sizeof( command ), "xdg-open %s", commandLine );
 
+   GT_PROBE1( launch_begin, commandLine );
+   gt_traceBegin( "gt_run", commandLine );
    int result = system( command );
+   gt_traceEnd();
+   GT_PROBE2( launch_end, commandLine, result );
    if( result != 0 )
    {
       fprintf( stderr, "Failed to open file \n" );
@@ -217,3 +236,316 @@ void gt_convertToSystemPath( char *path )
 {
    UNUSED( path );
 }
+
+/* ------------------------------------------------------------------------- */
+// Directory for files GT can rebuild at any time, e.g. font caches
+const char *gt_cacheDir( void )
+{
+   static char cacheDir[ PATH_MAX ] = { 0 };
+
+   if( cacheDir[ 0 ] == '\0' )
+   {
+      const char *xdg  = getenv( "XDG_CACHE_HOME" );
+      const char *home = getenv( "HOME" );
+
+      if( xdg && *xdg )
+      {
+         snprintf( cacheDir, sizeof( cacheDir ), "%s/gt", xdg );
+      }
+      else if( home && *home )
+      {
+         snprintf( cacheDir, sizeof( cacheDir ), "%s/.cache", home );
+         mkdir( cacheDir, 0755 );
+         snprintf( cacheDir, sizeof( cacheDir ), "%s/.cache/gt", home );
+      }
+      else
+      {
+         snprintf( cacheDir, sizeof( cacheDir ), "/tmp/gt-%d", ( int ) getuid() );
+      }
+      mkdir( cacheDir, 0755 );
+   }
+
+   return cacheDir;
+}
+
+// Maps a whole file read-only and shared, NULL if it does not exist
+void *gt_mapFile( const char *path, size_t *size )
+{
+   struct stat fileInfo;
+
+   int fd = open( path, O_RDONLY );
+   if( fd == -1 )
+   {
+      return NULL;
+   }
+
+   if( fstat( fd, &fileInfo ) == -1 || fileInfo.st_size == 0 )
+   {
+      close( fd );
+      return NULL;
+   }
+
+   void *data = mmap( NULL, fileInfo.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+   close( fd );
+   if( data == MAP_FAILED )
+   {
+      perror( "mmap" );
+      return NULL;
+   }
+
+   *size = fileInfo.st_size;
+   return data;
+}
+
+void gt_unmapFile( void *data, size_t size )
+{
+   munmap( data, size );
+}
+
+/* ------------------------------------------------------------------------- */
+// terminal the terminal renderer draws on, stdout; keys typed into it are neither echoed nor line buffered.
+// SIGWINCH and gt_terminalWake() write to a pipe, so gt_terminalRead() returns for them too.
+static struct termios   gtSavedTermios;
+static bool             gtTermiosSaved = F;
+static struct sigaction gtSavedWinch;
+static int              gtTermPipe[ 2 ] = { -1, -1 };
+static SDL_atomic_t     gtTermResized;   // lock-free, so the signal handler may set it
+
+// A full pipe means gt_terminalRead() has been woken already
+static void gt_terminalPoke( void )
+{
+   ssize_t written = write( gtTermPipe[ 1 ], "", 1 );
+   UNUSED( written );
+}
+
+static void gt_terminalWinch( int signal )
+{
+   int saved = errno;
+
+   UNUSED( signal );
+   SDL_AtomicSet( &gtTermResized, 1 );
+   gt_terminalPoke();
+   errno = saved;
+}
+
+// T when keys can be read from stdin with gt_terminalRead()
+bool gt_terminalOpen( void )
+{
+   if( !isatty( STDIN_FILENO ) || tcgetattr( STDIN_FILENO, &gtSavedTermios ) != 0 )
+   {
+      return F;
+   }
+   if( pipe( gtTermPipe ) != 0 )
+   {
+      perror( "pipe" );
+      return F;
+   }
+   fcntl( gtTermPipe[ 0 ], F_SETFL, O_NONBLOCK );
+   fcntl( gtTermPipe[ 1 ], F_SETFL, O_NONBLOCK );
+
+   // Signals still work, SDL turns Ctrl+C into SDL_QUIT
+   struct termios quiet = gtSavedTermios;
+   quiet.c_lflag &= ~( ECHO | ICANON );
+   quiet.c_cc[ VMIN ]  = 1;
+   quiet.c_cc[ VTIME ] = 0;
+   tcsetattr( STDIN_FILENO, TCSANOW, &quiet );
+   gtTermiosSaved = T;
+
+   struct sigaction winch;
+   memset( &winch, 0, sizeof( winch ) );
+   winch.sa_handler = gt_terminalWinch;
+   winch.sa_flags   = SA_RESTART;
+   sigemptyset( &winch.sa_mask );
+   sigaction( SIGWINCH, &winch, &gtSavedWinch );
+   return T;
+}
+
+void gt_terminalClose( void )
+{
+   if( gtTermiosSaved )
+   {
+      // Keys typed but not read yet are dropped instead of reaching the shell
+      tcsetattr( STDIN_FILENO, TCSAFLUSH, &gtSavedTermios );
+      sigaction( SIGWINCH, &gtSavedWinch, NULL );
+      close( gtTermPipe[ 0 ] );
+      close( gtTermPipe[ 1 ] );
+      gtTermPipe[ 0 ] = gtTermPipe[ 1 ] = -1;
+      gtTermiosSaved = F;
+   }
+}
+
+// Waits up to timeout milliseconds, -1 for ever, for bytes typed into the terminal. Returns how many were read,
+// 0 when the time is up, the terminal was resized or gt_terminalWake() was called, -1 when stdin is closed.
+int gt_terminalRead( char *buffer, size_t size, int timeout, bool *resized )
+{
+   struct pollfd fds[ 2 ] = { { STDIN_FILENO, POLLIN, 0 }, { gtTermPipe[ 0 ], POLLIN, 0 } };
+   char drain[ 64 ];
+
+   *resized = F;
+   int ready = poll( fds, 2, timeout );
+   if( ready < 0 && errno != EINTR )
+   {
+      return -1;
+   }
+
+   if( ready > 0 && ( fds[ 1 ].revents & POLLIN ) )
+   {
+      while( read( gtTermPipe[ 0 ], drain, sizeof( drain ) ) > 0 )
+      {
+      }
+   }
+   if( SDL_AtomicSet( &gtTermResized, 0 ) )
+   {
+      *resized = T;
+   }
+
+   if( ready > 0 && ( fds[ 0 ].revents & ( POLLIN | POLLHUP | POLLERR ) ) )
+   {
+      ssize_t count = read( STDIN_FILENO, buffer, size );
+      return IIF( count > 0, ( int ) count, -1 );
+   }
+   return 0;
+}
+
+// Makes a gt_terminalRead() on another thread return
+void gt_terminalWake( void )
+{
+   gt_terminalPoke();
+}
+
+// Size in character cells, F when stdout is not a terminal
+bool gt_terminalSize( int *cols, int *rows )
+{
+   struct winsize size;
+
+   if( ioctl( STDOUT_FILENO, TIOCGWINSZ, &size ) == 0 && size.ws_col > 0 && size.ws_row > 0 )
+   {
+      *cols = size.ws_col;
+      *rows = size.ws_row;
+      return T;
+   }
+   return F;
+}
+
+// Unbuffered, a frame is one write() unless the terminal is slower than the pipe
+void gt_terminalWrite( const char *bytes, size_t length )
+{
+   while( length > 0 )
+   {
+      ssize_t written = write( STDOUT_FILENO, bytes, length );
+      if( written < 0 )
+      {
+         if( errno == EINTR )
+         {
+            continue;
+         }
+         return;
+      }
+      bytes  += written;
+      length -= ( size_t ) written;
+   }
+}
+
+/* ------------------------------------------------------------------------- */
+// frame statistics, see src/stats.c
+long gt_processId( void )
+{
+   return ( long ) getpid();
+}
+
+// Nanoseconds of CPU time the calling thread used
+Uint64 gt_threadCpuTime( void )
+{
+   struct timespec time;
+
+   if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &time ) != 0 )
+   {
+      return 0;
+   }
+   return ( Uint64 ) time.tv_sec * 1000000000u + ( Uint64 ) time.tv_nsec;
+}
+
+bool gt_replaceFile( const char *from, const char *to )
+{
+   return rename( from, to ) == 0;
+}
+
+// Listens on a socket only the user can connect to, a socket left by an earlier run is replaced
+int gt_socketListen( const char *path )
+{
+   struct sockaddr_un address;
+   struct stat info;
+
+   if( strlen( path ) >= sizeof( address.sun_path ) )
+   {
+      fprintf( stderr, "Socket path too long: %s\n", path );
+      return -1;
+   }
+
+   int listener = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+   if( listener < 0 )
+   {
+      fprintf( stderr, "Unable to create socket: %s\n", strerror( errno ) );
+      return -1;
+   }
+
+   memset( &address, 0, sizeof( address ) );
+   address.sun_family = AF_UNIX;
+   strcpy( address.sun_path, path );
+
+   if( lstat( path, &info ) == 0 && S_ISSOCK( info.st_mode ) )
+   {
+      unlink( path );
+   }
+
+   if( bind( listener, ( struct sockaddr * ) &address, sizeof( address ) ) != 0 ||
+       chmod( path, S_IRUSR | S_IWUSR ) != 0 || listen( listener, 4 ) != 0 )
+   {
+      fprintf( stderr, "Unable to listen on %s: %s\n", path, strerror( errno ) );
+      close( listener );
+      return -1;
+   }
+   return listener;
+}
+
+// Blocks until a client connects, -1 once gt_socketShutdown() was called
+int gt_socketAccept( int listener )
+{
+   for( ;; )
+   {
+      int client = accept( listener, NULL, NULL );
+      if( client >= 0 || errno != EINTR )
+      {
+         return client;
+      }
+   }
+}
+
+void gt_socketSend( int socket, const char *bytes, size_t length )
+{
+   while( length > 0 )
+   {
+      ssize_t sent = send( socket, bytes, length, MSG_NOSIGNAL );
+      if( sent < 0 )
+      {
+         if( errno == EINTR )
+         {
+            continue;
+         }
+         return;
+      }
+      bytes  += sent;
+      length -= ( size_t ) sent;
+   }
+}
+
+// Wakes up a gt_socketAccept() waiting on another thread
+void gt_socketShutdown( int listener )
+{
+   shutdown( listener, SHUT_RDWR );
+}
+
+void gt_socketClose( int socket )
+{
+   close( socket );
+}
@@ -2,7 +2,7 @@
  *
  */
 
-#include "gt.h"
+#include "gt_private.h"
 
 /* ------------------------------------------------------------------------- */
 const char *gt_os( void )
@@ -28,7 +28,7 @@ struct tm ConvertSystemTimeToTm( const SYSTEMTIME *st )
    return tm;
 }
 
-FileInfo *gt_directory( const char *currentDir, int *size )
+static FileInfo *gt_readDirectory( const char *currentDir, int *size )
 {
    FileInfo *files = NULL;
    int count = 0;
@@ -132,6 +132,16 @@ FileInfo *gt_directory( const char *currentDir, int *size )
    return files;
 }
 
+FileInfo *gt_directory( const char *currentDir, int *size )
+{
+   GT_PROBE1( directory_begin, currentDir );
+   gt_traceBegin( "gt_directory", currentDir );
+   FileInfo *files = gt_readDirectory( currentDir, size );
+   gt_traceEnd();
+   GT_PROBE2( directory_end, currentDir, files ? *size : -1 );
+   return files;
+}
+
 void gt_freeDirectory( FileInfo *files )
 {
    free( files );
@@ -152,7 +162,11 @@ bool gt_runApp( const char *commandLine )
 
    snprintf( command, sizeof( command ), "start %s", commandLine );
 
+   GT_PROBE1( launch_begin, commandLine );
+   gt_traceBegin( "gt_runApp", commandLine );
    int result = system( command );
+   gt_traceEnd();
+   GT_PROBE2( launch_end, commandLine, result );
    if( result != 0 )
    {
       fprintf( stderr, "Failed to open command \n" );
@@ -178,7 +192,11 @@ bool gt_run( const char *commandLine )
    snprintf( command, sizeof( command ), "start %s", commandLine );
 
    // Execute the command and check the result
+   GT_PROBE1( launch_begin, commandLine );
+   gt_traceBegin( "gt_run", commandLine );
    int result = system( command );
+   gt_traceEnd();
+   GT_PROBE2( launch_end, commandLine, result );
    if( result != 0 )
    {
       fprintf( stderr, "Failed to open command \n" );
@@ -217,3 +235,268 @@ void gt_convertToSystemPath( char *path )
       }
    }
 }
+
+/* ------------------------------------------------------------------------- */
+// Directory for files GT can rebuild at any time, e.g. font caches
+const char *gt_cacheDir( void )
+{
+   static char cacheDir[ PATH_MAX ] = { 0 };
+
+   if( cacheDir[ 0 ] == '\0' )
+   {
+      const char *localAppData = getenv( "LOCALAPPDATA" );
+
+      if( localAppData && *localAppData )
+      {
+         snprintf( cacheDir, sizeof( cacheDir ), "%s\\gt", localAppData );
+      }
+      else
+      {
+         char tempPath[ PATH_MAX ];
+         GetTempPathA( sizeof( tempPath ), tempPath );
+         snprintf( cacheDir, sizeof( cacheDir ), "%sgt", tempPath );
+      }
+      CreateDirectoryA( cacheDir, NULL );
+   }
+
+   return cacheDir;
+}
+
+// Maps a whole file read-only, NULL if it does not exist
+void *gt_mapFile( const char *path, size_t *size )
+{
+   HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+   if( file == INVALID_HANDLE_VALUE )
+   {
+      return NULL;
+   }
+
+   LARGE_INTEGER fileSize;
+   if( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 )
+   {
+      CloseHandle( file );
+      return NULL;
+   }
+
+   HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+   CloseHandle( file );
+   if( !mapping )
+   {
+      fprintf( stderr, "CreateFileMapping failed: %lu\n", GetLastError() );
+      return NULL;
+   }
+
+   void *data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+   CloseHandle( mapping );
+   if( !data )
+   {
+      fprintf( stderr, "MapViewOfFile failed: %lu\n", GetLastError() );
+      return NULL;
+   }
+
+   *size = ( size_t ) fileSize.QuadPart;
+   return data;
+}
+
+void gt_unmapFile( void *data, size_t size )
+{
+   UNUSED( size );
+   UnmapViewOfFile( data );
+}
+
+/* ------------------------------------------------------------------------- */
+// console the terminal renderer draws on; it has to understand VT sequences and UTF-8. Keys arrive as VT
+// sequences too, so backend_term.c reads them the same way as on Linux.
+static DWORD   gtSavedOutputMode;
+static DWORD   gtSavedInputMode;
+static UINT    gtSavedCodePage;
+static bool    gtConsoleSaved = F;
+static HANDLE  gtTermWake = NULL;      // set by gt_terminalWake()
+static WCHAR   gtTermSurrogate = 0;    // high half of a character split across two key events
+
+// T when keys can be read from the console with gt_terminalRead()
+bool gt_terminalOpen( void )
+{
+   HANDLE output = GetStdHandle( STD_OUTPUT_HANDLE );
+   HANDLE input  = GetStdHandle( STD_INPUT_HANDLE );
+
+   if( !GetConsoleMode( output, &gtSavedOutputMode ) || !GetConsoleMode( input, &gtSavedInputMode ) )
+   {
+      return F;
+   }
+   gtTermWake = CreateEvent( NULL, FALSE, FALSE, NULL );
+   if( !gtTermWake )
+   {
+      fprintf( stderr, "CreateEvent failed: %lu\n", GetLastError() );
+      return F;
+   }
+
+   gtSavedCodePage = GetConsoleOutputCP();
+   SetConsoleMode( output, gtSavedOutputMode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING );
+   SetConsoleMode( input, ( gtSavedInputMode & ~( ENABLE_ECHO_INPUT | ENABLE_LINE_INPUT ) ) |
+                          ENABLE_VIRTUAL_TERMINAL_INPUT | ENABLE_WINDOW_INPUT );
+   SetConsoleOutputCP( CP_UTF8 );
+   gtTermSurrogate = 0;
+   gtConsoleSaved = T;
+   return T;
+}
+
+void gt_terminalClose( void )
+{
+   if( gtConsoleSaved )
+   {
+      // Keys typed but not read yet are dropped instead of reaching the shell
+      FlushConsoleInputBuffer( GetStdHandle( STD_INPUT_HANDLE ) );
+      SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), gtSavedOutputMode );
+      SetConsoleMode( GetStdHandle( STD_INPUT_HANDLE ), gtSavedInputMode );
+      SetConsoleOutputCP( gtSavedCodePage );
+      CloseHandle( gtTermWake );
+      gtTermWake = NULL;
+      gtConsoleSaved = F;
+   }
+}
+
+// Waits up to timeout milliseconds, -1 for ever, for keys typed into the console. Returns how many bytes of
+// UTF-8 were read, 0 when the time is up, the console was resized or gt_terminalWake() was called, -1 on errors.
+int gt_terminalRead( char *buffer, size_t size, int timeout, bool *resized )
+{
+   HANDLE input = GetStdHandle( STD_INPUT_HANDLE );
+   HANDLE handles[ 2 ] = { input, gtTermWake };
+   INPUT_RECORD records[ 16 ];
+   DWORD count;
+   int length = 0;
+
+   *resized = F;
+   DWORD wait = WaitForMultipleObjects( 2, handles, FALSE, IIF( timeout < 0, INFINITE, ( DWORD ) timeout ) );
+   if( wait == WAIT_FAILED )
+   {
+      return -1;
+   }
+   if( wait != WAIT_OBJECT_0 )
+   {
+      return 0;
+   }
+
+   // A UTF-16 unit takes at most 4 bytes of UTF-8, with a held surrogate
+   if( !ReadConsoleInputW( input, records, ( DWORD ) MIN( LEN( records ), size / 4 ), &count ) )
+   {
+      return -1;
+   }
+   for( DWORD r = 0; r < count; r++ )
+   {
+      if( records[ r ].EventType == WINDOW_BUFFER_SIZE_EVENT )
+      {
+         *resized = T;
+      }
+      else if( records[ r ].EventType == KEY_EVENT && records[ r ].Event.KeyEvent.bKeyDown &&
+               records[ r ].Event.KeyEvent.uChar.UnicodeChar != 0 )
+      {
+         WCHAR unit = records[ r ].Event.KeyEvent.uChar.UnicodeChar;
+         WCHAR units[ 2 ];
+         int   unitCount = 0;
+
+         if( IS_HIGH_SURROGATE( unit ) )
+         {
+            gtTermSurrogate = unit;
+            continue;
+         }
+         if( IS_LOW_SURROGATE( unit ) && gtTermSurrogate )
+         {
+            units[ unitCount++ ] = gtTermSurrogate;
+         }
+         units[ unitCount++ ] = unit;
+         gtTermSurrogate = 0;
+
+         length += WideCharToMultiByte( CP_UTF8, 0, units, unitCount, buffer + length, ( int ) size - length, NULL, NULL );
+      }
+   }
+   return length;
+}
+
+// Makes a gt_terminalRead() on another thread return
+void gt_terminalWake( void )
+{
+   SetEvent( gtTermWake );
+}
+
+// Size of the visible window in character cells, F when stdout is not a console
+bool gt_terminalSize( int *cols, int *rows )
+{
+   CONSOLE_SCREEN_BUFFER_INFO info;
+
+   if( GetConsoleScreenBufferInfo( GetStdHandle( STD_OUTPUT_HANDLE ), &info ) )
+   {
+      *cols = info.srWindow.Right - info.srWindow.Left + 1;
+      *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+      return T;
+   }
+   return F;
+}
+
+void gt_terminalWrite( const char *bytes, size_t length )
+{
+   HANDLE output = GetStdHandle( STD_OUTPUT_HANDLE );
+   DWORD written;
+
+   while( length > 0 && WriteFile( output, bytes, ( DWORD ) length, &written, NULL ) && written > 0 )
+   {
+      bytes  += written;
+      length -= written;
+   }
+}
+
+/* ------------------------------------------------------------------------- */
+// frame statistics, see src/stats.c
+long gt_processId( void )
+{
+   return ( long ) GetCurrentProcessId();
+}
+
+// Nanoseconds of CPU time the calling thread used
+Uint64 gt_threadCpuTime( void )
+{
+   FILETIME creation, exit, kernel, user;
+
+   if( !GetThreadTimes( GetCurrentThread(), &creation, &exit, &kernel, &user ) )
+   {
+      return 0;
+   }
+   Uint64 kernelTime = ( ( Uint64 ) kernel.dwHighDateTime << 32 ) | kernel.dwLowDateTime;
+   Uint64 userTime   = ( ( Uint64 ) user.dwHighDateTime << 32 ) | user.dwLowDateTime;
+   return ( kernelTime + userTime ) * 100;
+}
+
+bool gt_replaceFile( const char *from, const char *to )
+{
+   return MoveFileExA( from, to, MOVEFILE_REPLACE_EXISTING ) != 0;
+}
+
+// Statistics are exported to files only, Unix sockets are not wired up on Windows
+int gt_socketListen( const char *path )
+{
+   fprintf( stderr, "Unable to listen on %s: Unix sockets are not supported on Windows.\n", path );
+   return -1;
+}
+
+int gt_socketAccept( int listener )
+{
+   UNUSED( listener );
+   return -1;
+}
+
+void gt_socketSend( int socket, const char *bytes, size_t length )
+{
+   UNUSED( socket );
+   UNUSED( bytes );
+   UNUSED( length );
+}
+
+void gt_socketShutdown( int listener )
+{
+   UNUSED( listener );
+}
+
+void gt_socketClose( int socket )
+{
+   UNUSED( socket );
+}
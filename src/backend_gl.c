@@ -0,0 +1,387 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// helpers
+void gt_clearColor( gt_color color )
+{
+   glClearColor( GT_R( color ) / 255.0f, GT_G( color ) / 255.0f, GT_B( color ) / 255.0f, GT_A( color ) / 255.0f );
+}
+
+/* ------------------------------------------------------------------------- */
+// glyph atlas
+static GTAtlas *gtAtlases[ 2 ][ GT_MAX_WINDOWS ];  // legacy, core profile; a window draws with one at a time
+GTAtlas        *gtAtlas = NULL;
+
+int    gtGLCalls = 0;
+size_t gtGLBytes = 0;
+
+// Pixel store state belongs to the context, glyphs may be rasterized from any window of the group
+static void gt_atlasUpload( int slot, const unsigned char *alpha )
+{
+   glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+   glBindTexture( GL_TEXTURE_2D, gtAtlas->texture );
+   glTexSubImage2D( GL_TEXTURE_2D, 0,
+                    ( slot % gtAtlas->cols ) * gtAtlas->font->width,
+                    ( slot / gtAtlas->cols ) * gtAtlas->font->height,
+                    gtAtlas->font->width, gtAtlas->font->height, gtAtlas->format, GL_UNSIGNED_BYTE, alpha );
+   gtGLCalls++;
+   gtGLBytes += gtAtlas->font->width * gtAtlas->font->height;
+}
+
+static void gt_atlasSetSlot( unsigned int codepoint, int slot )
+{
+   gtAtlas->slot[ codepoint ] = slot;
+
+   if( gtAtlas->lookup )
+   {
+      GLushort value = slot;
+      glBindTexture( GL_TEXTURE_2D, gtAtlas->lookup );
+      glTexSubImage2D( GL_TEXTURE_2D, 0, codepoint & 0xFF, codepoint >> 8, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_SHORT, &value );
+      gtGLCalls++;
+      gtGLBytes += sizeof( value );
+   }
+}
+
+static void gt_atlasInit( const GTFont *font, bool coreProfile )
+{
+   unsigned char solid[ GT_FONT_MAX_HEIGHT * GT_FONT_MAX_WIDTH ];
+
+   gtAtlas->font   = font;
+   gtAtlas->cols   = ATLAS_SIZE / font->width;
+   gtAtlas->slots  = gtAtlas->cols * ( ATLAS_SIZE / font->height );
+   gtAtlas->format = IIF( coreProfile, GL_RED, GL_ALPHA );
+
+   glGenTextures( 1, &gtAtlas->texture );
+   glBindTexture( GL_TEXTURE_2D, gtAtlas->texture );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glTexImage2D( GL_TEXTURE_2D, 0, IIF( coreProfile, GL_R8, GL_ALPHA ), ATLAS_SIZE, ATLAS_SIZE, 0, gtAtlas->format, GL_UNSIGNED_BYTE, NULL );
+
+   if( coreProfile )
+   {
+      // 256 x 256 texels, one per BMP codepoint; every codepoint is written before it is drawn
+      glGenTextures( 1, &gtAtlas->lookup );
+      glBindTexture( GL_TEXTURE_2D, gtAtlas->lookup );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+      glTexImage2D( GL_TEXTURE_2D, 0, GL_R16UI, 256, 256, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, NULL );
+   }
+
+   memset( solid, 255, sizeof( solid ) );
+   gt_atlasUpload( 0, solid );
+
+   gtAtlas->next = 1;
+   gt_atlasGlyph( 0xFFFD );
+}
+
+// Selects the atlas of the window's font, shared with the windows of the group drawing with the same font.
+// Called with the window's context current, F when memory ran out.
+bool gt_atlasUse( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+   bool coreProfile = gt->backend == &gtBackendGLCore;
+   GTAtlas **unused = NULL;
+
+   if( gl->atlas && gl->atlas->font == gt->font )
+   {
+      gtAtlas = gl->atlas;
+      return T;
+   }
+   gt_atlasRelease( gt );
+
+   for( int a = 0; a < GT_MAX_WINDOWS; a++ )
+   {
+      GTAtlas **atlas = &gtAtlases[ coreProfile ][ a ];
+
+      if( *atlas && ( *atlas )->font == gt->font )
+      {
+         gl->atlas = gtAtlas = *atlas;
+         gtAtlas->users++;
+         return T;
+      }
+      if( !*atlas && !unused )
+      {
+         unused = atlas;
+      }
+   }
+
+   // There is always an unused entry, each window holds at most one atlas
+   gtAtlas = malloc( sizeof( GTAtlas ) );
+   if( !gtAtlas )
+   {
+      fprintf( stderr, "Memory allocation failed for glyph atlas.\n" );
+      return F;
+   }
+   memset( gtAtlas, 0, sizeof( GTAtlas ) );
+   gt_atlasInit( gt->font, coreProfile );
+
+   gtAtlas->users = 1;
+   gl->atlas = *unused = gtAtlas;
+   return T;
+}
+
+// The window stops drawing with its atlas, the last window using it frees it; called with a context of the group current
+void gt_atlasRelease( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+   GTAtlas *atlas = gl->atlas;
+   GTAtlas **atlases = gtAtlases[ gt->backend == &gtBackendGLCore ];
+
+   if( !atlas )
+   {
+      return;
+   }
+   gl->atlas = NULL;
+   if( --atlas->users > 0 )
+   {
+      return;
+   }
+
+   for( int a = 0; a < GT_MAX_WINDOWS; a++ )
+   {
+      if( atlases[ a ] == atlas )
+      {
+         atlases[ a ] = NULL;
+      }
+   }
+   if( atlas->lookup )
+   {
+      glDeleteTextures( 1, &atlas->lookup );
+   }
+   glDeleteTextures( 1, &atlas->texture );
+   if( gtAtlas == atlas )
+   {
+      gtAtlas = NULL;
+   }
+   free( atlas );
+}
+
+// Returns the atlas slot of a glyph, rasterizing it on first use
+int gt_atlasGlyph( unsigned int codepoint )
+{
+   if( codepoint >= ENCODING )
+   {
+      codepoint = 0xFFFD;
+   }
+
+   if( gtAtlas->slot[ codepoint ] == 0 )
+   {
+      unsigned char alpha[ GT_FONT_MAX_HEIGHT * GT_FONT_MAX_WIDTH ];
+      const GTFont *font = gtAtlas->font;
+      const Uint16 *glyph = gt_glyphLookup( font, codepoint );
+
+      if( gtAtlas->next >= gtAtlas->slots || ( codepoint != 0xFFFD && !gt_glyphExists( font, codepoint ) ) )
+      {
+         // Missing glyphs, and every glyph once the atlas is full, share the replacement character
+         gt_atlasSetSlot( codepoint, gtAtlas->slot[ 0xFFFD ] );
+         return gtAtlas->slot[ codepoint ];
+      }
+
+      for( int row = 0; row < font->height; row++ )
+      {
+         unsigned int value = glyph[ row ];
+         for( int col = 0; col < font->width; col++ )
+         {
+            alpha[ row * font->width + col ] = ( value & ( 1 << ( 15 - col ) ) ) ? 255 : 0;
+         }
+      }
+
+      gt_atlasUpload( gtAtlas->next, alpha );
+      gt_atlasSetSlot( codepoint, gtAtlas->next++ );
+   }
+
+   return gtAtlas->slot[ codepoint ];
+}
+
+/* ------------------------------------------------------------------------- */
+// framebuffer objects, loaded at run time since opengl32.dll only exports GL 1.1
+PFNGLGENFRAMEBUFFERSPROC        gt_glGenFramebuffers;
+PFNGLDELETEFRAMEBUFFERSPROC     gt_glDeleteFramebuffers;
+PFNGLBINDFRAMEBUFFERPROC        gt_glBindFramebuffer;
+PFNGLFRAMEBUFFERTEXTURE2DPROC   gt_glFramebufferTexture2D;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC gt_glCheckFramebufferStatus;
+PFNGLBLITFRAMEBUFFERPROC        gt_glBlitFramebuffer;
+
+bool gt_loadFramebufferFunctions( void )
+{
+   gt_glGenFramebuffers        = ( PFNGLGENFRAMEBUFFERSPROC ) SDL_GL_GetProcAddress( "glGenFramebuffers" );
+   gt_glDeleteFramebuffers     = ( PFNGLDELETEFRAMEBUFFERSPROC ) SDL_GL_GetProcAddress( "glDeleteFramebuffers" );
+   gt_glBindFramebuffer        = ( PFNGLBINDFRAMEBUFFERPROC ) SDL_GL_GetProcAddress( "glBindFramebuffer" );
+   gt_glFramebufferTexture2D   = ( PFNGLFRAMEBUFFERTEXTURE2DPROC ) SDL_GL_GetProcAddress( "glFramebufferTexture2D" );
+   gt_glCheckFramebufferStatus = ( PFNGLCHECKFRAMEBUFFERSTATUSPROC ) SDL_GL_GetProcAddress( "glCheckFramebufferStatus" );
+   gt_glBlitFramebuffer        = ( PFNGLBLITFRAMEBUFFERPROC ) SDL_GL_GetProcAddress( "glBlitFramebuffer" );
+
+   return gt_glGenFramebuffers && gt_glDeleteFramebuffers && gt_glBindFramebuffer &&
+          gt_glFramebufferTexture2D && gt_glCheckFramebufferStatus && gt_glBlitFramebuffer;
+}
+
+/* ------------------------------------------------------------------------- */
+// buffer objects, shared by the legacy vertex batch and the core instance buffer
+PFNGLGENBUFFERSPROC    gt_glGenBuffers;
+PFNGLDELETEBUFFERSPROC gt_glDeleteBuffers;
+PFNGLBINDBUFFERPROC    gt_glBindBuffer;
+PFNGLBUFFERDATAPROC    gt_glBufferData;
+PFNGLBUFFERSUBDATAPROC gt_glBufferSubData;
+
+bool gt_loadBufferFunctions( void )
+{
+   gt_glGenBuffers    = ( PFNGLGENBUFFERSPROC ) SDL_GL_GetProcAddress( "glGenBuffers" );
+   gt_glDeleteBuffers = ( PFNGLDELETEBUFFERSPROC ) SDL_GL_GetProcAddress( "glDeleteBuffers" );
+   gt_glBindBuffer    = ( PFNGLBINDBUFFERPROC ) SDL_GL_GetProcAddress( "glBindBuffer" );
+   gt_glBufferData    = ( PFNGLBUFFERDATAPROC ) SDL_GL_GetProcAddress( "glBufferData" );
+   gt_glBufferSubData = ( PFNGLBUFFERSUBDATAPROC ) SDL_GL_GetProcAddress( "glBufferSubData" );
+
+   return gt_glGenBuffers && gt_glDeleteBuffers && gt_glBindBuffer && gt_glBufferData && gt_glBufferSubData;
+}
+
+/* ------------------------------------------------------------------------- */
+// window, context and frame handling of both GL renderers
+bool gt_glCreateContext( GT *gt, const char *title )
+{
+   GTGLWindow *gl = calloc( 1, sizeof( GTGLWindow ) );
+   if( !gl )
+   {
+      fprintf( stderr, "Memory allocation failed for GL window.\n" );
+      return F;
+   }
+
+   if( !gt_openWindow( gt, title, SDL_WINDOW_OPENGL | SDL_WINDOW_ALLOW_HIGHDPI ) )
+   {
+      free( gl );
+      return F;
+   }
+
+   // Windows of one renderer share a context group, so textures and buffers, the atlas among them, exist once
+   GT *share = gt_otherWindow( gt, gt->backend );
+   if( share )
+   {
+      gt_glMakeCurrent( share );
+      SDL_GL_SetAttribute( SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1 );
+   }
+
+#ifdef GT_GL_DEBUG
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG );
+#endif
+   gt->glContext = SDL_GL_CreateContext( gt->window );
+   SDL_GL_SetAttribute( SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0 );
+#ifdef GT_GL_DEBUG
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_FLAGS, 0 );
+#endif
+   if( !gt->glContext )
+   {
+      fprintf( stderr, "SDL_GL_CreateContext failed: %s\n", SDL_GetError() );
+      gt_closeWindow( gt );
+      free( gl );
+      return F;
+   }
+
+   gt->backendData = gl;
+   gt_glDebugInit( gt );
+   return T;
+}
+
+// Every GL call of a window goes to its own context, switching only when another window's context is current
+void gt_glMakeCurrent( GT *gt )
+{
+   if( SDL_GL_GetCurrentContext() != gt->glContext )
+   {
+      SDL_GL_MakeCurrent( gt->window, gt->glContext );
+   }
+}
+
+// HiDPI drawables are larger than the window, the ratio is kept for mouse coordinates and the scale
+void gt_glBeginFrame( GT *gt, int *width, int *height )
+{
+   int windowWidth, windowHeight;
+
+   SDL_GL_GetDrawableSize( gt->window, width, height );
+   SDL_GetWindowSize( gt->window, &windowWidth, &windowHeight );
+   gt->pixelRatio = MAX( 1, *width / MAX( 1, windowWidth ) );
+}
+
+void gt_glPresent( GT *gt )
+{
+   gt_glMakeCurrent( gt );
+   REPORT_OPENGL_ERROR( "End drawing: " );
+   gt_glTimerBegin( gt, GT_GPU_SWAP );
+   SDL_GL_SwapWindow( gt->window );
+   gt_glTimerEnd( gt, GT_GPU_SWAP );
+   gt_glTimerFrame( gt );
+
+   gt->frameCounts.glCalls       += gtGLCalls + 1;
+   gt->frameCounts.bytesUploaded += gtGLBytes;
+   gtGLCalls = 0;
+   gtGLBytes = 0;
+}
+
+bool gt_glReadPixels( GT *gt, int x, int y, int width, int height, gt_color *pixels )
+{
+   GTGLWindow *gl = gt->backendData;
+
+   gt_glMakeCurrent( gt );
+
+   // The canvas still holds the frame; without one the swapped front buffer is read
+   if( gl->canvasFramebuffer )
+   {
+      gt_glBindFramebuffer( GL_READ_FRAMEBUFFER, gl->canvasFramebuffer );
+   }
+   else
+   {
+      glReadBuffer( GL_FRONT );
+   }
+
+   glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+   glReadPixels( x, gt->height - y - height, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+
+   if( gl->canvasFramebuffer )
+   {
+      gt_glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+   }
+   else
+   {
+      glReadBuffer( GL_BACK );
+   }
+
+   // OpenGL returns the bottom row first, bytes in R, G, B, A order
+   for( int row = 0; row < height / 2; row++ )
+   {
+      gt_color *top    = pixels + row * width;
+      gt_color *bottom = pixels + ( height - 1 - row ) * width;
+      for( int col = 0; col < width; col++ )
+      {
+         gt_color swap = top[ col ];
+         top[ col ]    = bottom[ col ];
+         bottom[ col ] = swap;
+      }
+   }
+   for( int i = 0; i < width * height; i++ )
+   {
+      const Uint8 *rgba = ( const Uint8 * ) &pixels[ i ];
+      pixels[ i ] = GT_RGBA( rgba[ 0 ], rgba[ 1 ], rgba[ 2 ], rgba[ 3 ] );
+   }
+
+   GLenum errCode;
+   check_open_gl_error( "Read pixels: ", __FILE__, __LINE__, &errCode );
+   return errCode == GL_NO_ERROR;
+}
+
+void gt_glDestroy( GT *gt )
+{
+   if( gt->glContext )
+   {
+      gt_glMakeCurrent( gt );
+      gt_glDebugFree( gt );
+      gt_atlasRelease( gt );
+      SDL_GL_DeleteContext( gt->glContext );
+      gt->glContext = NULL;
+   }
+   free( gt->backendData );
+   gt->backendData = NULL;
+   gt_closeWindow( gt );
+}
@@ -0,0 +1,361 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// OpenGL 3.3 core profile renderer, the cell grid itself is the per-instance attribute buffer
+static PFNGLACTIVETEXTUREPROC           gt_glActiveTexture;
+static PFNGLCREATESHADERPROC            gt_glCreateShader;
+static PFNGLSHADERSOURCEPROC            gt_glShaderSource;
+static PFNGLCOMPILESHADERPROC           gt_glCompileShader;
+static PFNGLGETSHADERIVPROC             gt_glGetShaderiv;
+static PFNGLGETSHADERINFOLOGPROC        gt_glGetShaderInfoLog;
+static PFNGLDELETESHADERPROC            gt_glDeleteShader;
+static PFNGLCREATEPROGRAMPROC           gt_glCreateProgram;
+static PFNGLATTACHSHADERPROC            gt_glAttachShader;
+static PFNGLLINKPROGRAMPROC             gt_glLinkProgram;
+static PFNGLGETPROGRAMIVPROC            gt_glGetProgramiv;
+static PFNGLGETPROGRAMINFOLOGPROC       gt_glGetProgramInfoLog;
+static PFNGLDELETEPROGRAMPROC           gt_glDeleteProgram;
+static PFNGLUSEPROGRAMPROC              gt_glUseProgram;
+static PFNGLGETUNIFORMLOCATIONPROC      gt_glGetUniformLocation;
+static PFNGLUNIFORM1IPROC               gt_glUniform1i;
+static PFNGLUNIFORM2FPROC               gt_glUniform2f;
+static PFNGLGENVERTEXARRAYSPROC         gt_glGenVertexArrays;
+static PFNGLDELETEVERTEXARRAYSPROC      gt_glDeleteVertexArrays;
+static PFNGLBINDVERTEXARRAYPROC         gt_glBindVertexArray;
+static PFNGLENABLEVERTEXATTRIBARRAYPROC gt_glEnableVertexAttribArray;
+static PFNGLVERTEXATTRIBPOINTERPROC     gt_glVertexAttribPointer;
+static PFNGLVERTEXATTRIBIPOINTERPROC    gt_glVertexAttribIPointer;
+static PFNGLVERTEXATTRIBDIVISORPROC     gt_glVertexAttribDivisor;
+static PFNGLDRAWARRAYSINSTANCEDPROC     gt_glDrawArraysInstanced;
+
+static const char *gtCoreVertexShader =
+   "layout( location = 0 ) in uint aCodepoint;\n"
+   "layout( location = 1 ) in vec4 aFg;\n"
+   "layout( location = 2 ) in vec4 aBg;\n"
+   "uniform usampler2D uLookup;\n"
+   "uniform int  uCols;\n"
+   "uniform int  uAtlasCols;\n"
+   "uniform vec2 uCell;\n"   // drawable pixels
+   "uniform vec2 uGlyph;\n"  // atlas texels, uCell / uGlyph is the integer scale
+   "uniform vec2 uViewport;\n"
+   "out vec2 vTexCoord;\n"
+   "flat out vec4 vFg;\n"
+   "flat out vec4 vBg;\n"
+   "void main()\n"
+   "{\n"
+   "   vec2 corner = vec2( gl_VertexID & 1, gl_VertexID >> 1 );\n"
+   "   vec2 pixel  = ( vec2( gl_InstanceID % uCols, gl_InstanceID / uCols ) + corner ) * uCell;\n"
+   "   gl_Position = vec4( pixel.x / uViewport.x * 2.0 - 1.0, 1.0 - pixel.y / uViewport.y * 2.0, 0.0, 1.0 );\n"
+   "   uint codepoint = min( aCodepoint, 0xFFFDu );\n"
+   "   int slot = int( texelFetch( uLookup, ivec2( codepoint & 255u, codepoint >> 8 ), 0 ).r );\n"
+   "   vTexCoord = ( vec2( slot % uAtlasCols, slot / uAtlasCols ) + corner ) * uGlyph / ATLAS_SIZE;\n"
+   "   vFg = aFg.wzyx;\n" // gt_color is 0xRRGGBBAA, stored little-endian
+   "   vBg = aBg.wzyx;\n"
+   "}\n";
+
+static const char *gtCoreFragmentShader =
+   "in vec2 vTexCoord;\n"
+   "flat in vec4 vFg;\n"
+   "flat in vec4 vBg;\n"
+   "uniform sampler2D uAtlas;\n"
+   "out vec4 fragColor;\n"
+   "void main()\n"
+   "{\n"
+   "   fragColor = mix( vBg, vFg, vFg.a * texture( uAtlas, vTexCoord ).r );\n"
+   "}\n";
+
+static bool gt_loadCoreFunctions( void )
+{
+   gt_glActiveTexture           = ( PFNGLACTIVETEXTUREPROC ) SDL_GL_GetProcAddress( "glActiveTexture" );
+   gt_glCreateShader            = ( PFNGLCREATESHADERPROC ) SDL_GL_GetProcAddress( "glCreateShader" );
+   gt_glShaderSource            = ( PFNGLSHADERSOURCEPROC ) SDL_GL_GetProcAddress( "glShaderSource" );
+   gt_glCompileShader           = ( PFNGLCOMPILESHADERPROC ) SDL_GL_GetProcAddress( "glCompileShader" );
+   gt_glGetShaderiv             = ( PFNGLGETSHADERIVPROC ) SDL_GL_GetProcAddress( "glGetShaderiv" );
+   gt_glGetShaderInfoLog        = ( PFNGLGETSHADERINFOLOGPROC ) SDL_GL_GetProcAddress( "glGetShaderInfoLog" );
+   gt_glDeleteShader            = ( PFNGLDELETESHADERPROC ) SDL_GL_GetProcAddress( "glDeleteShader" );
+   gt_glCreateProgram           = ( PFNGLCREATEPROGRAMPROC ) SDL_GL_GetProcAddress( "glCreateProgram" );
+   gt_glAttachShader            = ( PFNGLATTACHSHADERPROC ) SDL_GL_GetProcAddress( "glAttachShader" );
+   gt_glLinkProgram             = ( PFNGLLINKPROGRAMPROC ) SDL_GL_GetProcAddress( "glLinkProgram" );
+   gt_glGetProgramiv            = ( PFNGLGETPROGRAMIVPROC ) SDL_GL_GetProcAddress( "glGetProgramiv" );
+   gt_glGetProgramInfoLog       = ( PFNGLGETPROGRAMINFOLOGPROC ) SDL_GL_GetProcAddress( "glGetProgramInfoLog" );
+   gt_glDeleteProgram           = ( PFNGLDELETEPROGRAMPROC ) SDL_GL_GetProcAddress( "glDeleteProgram" );
+   gt_glUseProgram              = ( PFNGLUSEPROGRAMPROC ) SDL_GL_GetProcAddress( "glUseProgram" );
+   gt_glGetUniformLocation      = ( PFNGLGETUNIFORMLOCATIONPROC ) SDL_GL_GetProcAddress( "glGetUniformLocation" );
+   gt_glUniform1i               = ( PFNGLUNIFORM1IPROC ) SDL_GL_GetProcAddress( "glUniform1i" );
+   gt_glUniform2f               = ( PFNGLUNIFORM2FPROC ) SDL_GL_GetProcAddress( "glUniform2f" );
+   gt_glGenVertexArrays         = ( PFNGLGENVERTEXARRAYSPROC ) SDL_GL_GetProcAddress( "glGenVertexArrays" );
+   gt_glDeleteVertexArrays      = ( PFNGLDELETEVERTEXARRAYSPROC ) SDL_GL_GetProcAddress( "glDeleteVertexArrays" );
+   gt_glBindVertexArray         = ( PFNGLBINDVERTEXARRAYPROC ) SDL_GL_GetProcAddress( "glBindVertexArray" );
+   gt_glEnableVertexAttribArray = ( PFNGLENABLEVERTEXATTRIBARRAYPROC ) SDL_GL_GetProcAddress( "glEnableVertexAttribArray" );
+   gt_glVertexAttribPointer     = ( PFNGLVERTEXATTRIBPOINTERPROC ) SDL_GL_GetProcAddress( "glVertexAttribPointer" );
+   gt_glVertexAttribIPointer    = ( PFNGLVERTEXATTRIBIPOINTERPROC ) SDL_GL_GetProcAddress( "glVertexAttribIPointer" );
+   gt_glVertexAttribDivisor     = ( PFNGLVERTEXATTRIBDIVISORPROC ) SDL_GL_GetProcAddress( "glVertexAttribDivisor" );
+   gt_glDrawArraysInstanced     = ( PFNGLDRAWARRAYSINSTANCEDPROC ) SDL_GL_GetProcAddress( "glDrawArraysInstanced" );
+
+   return gt_loadBufferFunctions() &&
+          gt_glActiveTexture && gt_glCreateShader && gt_glShaderSource && gt_glCompileShader &&
+          gt_glGetShaderiv && gt_glGetShaderInfoLog && gt_glDeleteShader && gt_glCreateProgram &&
+          gt_glAttachShader && gt_glLinkProgram && gt_glGetProgramiv && gt_glGetProgramInfoLog &&
+          gt_glDeleteProgram && gt_glUseProgram && gt_glGetUniformLocation && gt_glUniform1i &&
+          gt_glUniform2f && gt_glGenVertexArrays && gt_glDeleteVertexArrays && gt_glBindVertexArray &&
+          gt_glEnableVertexAttribArray && gt_glVertexAttribPointer && gt_glVertexAttribIPointer &&
+          gt_glVertexAttribDivisor && gt_glDrawArraysInstanced;
+}
+
+static GLuint gt_compileShader( GLenum type, const char *source )
+{
+   char prelude[ 256 ];
+   char log[ 1024 ];
+   GLint status;
+
+   snprintf( prelude, sizeof( prelude ),
+             "#version 330 core\n"
+             "#define ATLAS_SIZE %d.0\n",
+             ATLAS_SIZE );
+
+   const char *sources[ 2 ] = { prelude, source };
+
+   GLuint shader = gt_glCreateShader( type );
+   gt_glShaderSource( shader, 2, sources, NULL );
+   gt_glCompileShader( shader );
+   gt_glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+   if( !status )
+   {
+      gt_glGetShaderInfoLog( shader, sizeof( log ), NULL, log );
+      fprintf( stderr, "Shader compilation failed: %s\n", log );
+      gt_glDeleteShader( shader );
+      return 0;
+   }
+
+   return shader;
+}
+
+static bool gt_coreCreate( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+   char log[ 1024 ];
+   GLint status;
+
+   if( !gt_loadCoreFunctions() )
+   {
+      fprintf( stderr, "OpenGL 3.3 entry points are missing.\n" );
+      return F;
+   }
+
+   GLuint vertexShader   = gt_compileShader( GL_VERTEX_SHADER, gtCoreVertexShader );
+   GLuint fragmentShader = gt_compileShader( GL_FRAGMENT_SHADER, gtCoreFragmentShader );
+   if( !vertexShader || !fragmentShader )
+   {
+      if( vertexShader ) gt_glDeleteShader( vertexShader );
+      if( fragmentShader ) gt_glDeleteShader( fragmentShader );
+      return F;
+   }
+
+   gl->program = gt_glCreateProgram();
+   gt_glAttachShader( gl->program, vertexShader );
+   gt_glAttachShader( gl->program, fragmentShader );
+   gt_glLinkProgram( gl->program );
+   gt_glDeleteShader( vertexShader );
+   gt_glDeleteShader( fragmentShader );
+
+   gt_glGetProgramiv( gl->program, GL_LINK_STATUS, &status );
+   if( !status )
+   {
+      gt_glGetProgramInfoLog( gl->program, sizeof( log ), NULL, log );
+      fprintf( stderr, "Shader program link failed: %s\n", log );
+      gt_glDeleteProgram( gl->program );
+      gl->program = 0;
+      return F;
+   }
+
+   gt_glUseProgram( gl->program );
+   gt_glUniform1i( gt_glGetUniformLocation( gl->program, "uAtlas" ), 0 );
+   gt_glUniform1i( gt_glGetUniformLocation( gl->program, "uLookup" ), 1 );
+   gt_glUseProgram( 0 );
+
+   gl->uCols      = gt_glGetUniformLocation( gl->program, "uCols" );
+   gl->uViewport  = gt_glGetUniformLocation( gl->program, "uViewport" );
+   gl->uCell      = gt_glGetUniformLocation( gl->program, "uCell" );
+   gl->uGlyph     = gt_glGetUniformLocation( gl->program, "uGlyph" );
+   gl->uAtlasCols = gt_glGetUniformLocation( gl->program, "uAtlasCols" );
+
+   gt_glGenVertexArrays( 1, &gl->vertexArray );
+   gt_glGenBuffers( 1, &gl->instanceBuffer );
+   gt_glBindVertexArray( gl->vertexArray );
+   gt_glBindBuffer( GL_ARRAY_BUFFER, gl->instanceBuffer );
+
+   gt_glEnableVertexAttribArray( 0 );
+   gt_glVertexAttribIPointer( 0, 1, GL_UNSIGNED_INT, sizeof( GTCell ), ( const void * ) offsetof( GTCell, codepoint ) );
+   gt_glVertexAttribDivisor( 0, 1 );
+   gt_glEnableVertexAttribArray( 1 );
+   gt_glVertexAttribPointer( 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( GTCell ), ( const void * ) offsetof( GTCell, fg ) );
+   gt_glVertexAttribDivisor( 1, 1 );
+   gt_glEnableVertexAttribArray( 2 );
+   gt_glVertexAttribPointer( 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( GTCell ), ( const void * ) offsetof( GTCell, bg ) );
+   gt_glVertexAttribDivisor( 2, 1 );
+
+   gt_glBindVertexArray( 0 );
+   gt_glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+   return T;
+}
+
+static void gt_coreFree( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+
+   if( gl->instanceBuffer )
+   {
+      gt_glDeleteBuffers( 1, &gl->instanceBuffer );
+      gl->instanceBuffer = 0;
+   }
+   if( gl->vertexArray )
+   {
+      gt_glDeleteVertexArrays( 1, &gl->vertexArray );
+      gl->vertexArray = 0;
+   }
+   if( gl->program )
+   {
+      gt_glDeleteProgram( gl->program );
+      gl->program = 0;
+   }
+}
+
+// Re-uploads only the span of cells that changed, then draws every cell with one instanced call
+static void gt_coreSubmit( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+   int count = gt->cellCols * gt->cellRows;
+   int first = count;
+   int last  = -1;
+
+   gt_glMakeCurrent( gt );
+   if( !gt_atlasUse( gt ) )
+   {
+      return;
+   }
+
+   for( int i = 0; i < count; i++ )
+   {
+      if( gt->fullRedraw || memcmp( &gt->cells[ i ], &gt->prevCells[ i ], sizeof( GTCell ) ) != 0 )
+      {
+         gt_atlasGlyph( gt->cells[ i ].codepoint );
+         first = MIN( first, i );
+         last  = i;
+      }
+   }
+
+   gt_glTimerBegin( gt, GT_GPU_SUBMIT );
+   glViewport( 0, 0, gt->width, gt->height );
+   glDisable( GL_BLEND );
+   gt_clearColor( gt->backgroundColor );
+   glClear( GL_COLOR_BUFFER_BIT );
+
+   gt_glUseProgram( gl->program );
+   gt_glBindVertexArray( gl->vertexArray );
+
+   if( last >= first )
+   {
+      gt_glBindBuffer( GL_ARRAY_BUFFER, gl->instanceBuffer );
+      gt_glBufferSubData( GL_ARRAY_BUFFER, sizeof( GTCell ) * first, sizeof( GTCell ) * ( last - first + 1 ), gt->cells + first );
+      gt_glBindBuffer( GL_ARRAY_BUFFER, 0 );
+      gtGLCalls++;
+      gtGLBytes += sizeof( GTCell ) * ( last - first + 1 );
+   }
+
+   gt_glUniform1i( gl->uCols, gt->cellCols );
+   gt_glUniform2f( gl->uViewport, gt->width, gt->height );
+   gt_glUniform2f( gl->uCell, gt->cellWidth, gt->cellHeight );
+   gt_glUniform2f( gl->uGlyph, gt->font->width, gt->font->height );
+   gt_glUniform1i( gl->uAtlasCols, gtAtlas->cols );
+
+   gt_glActiveTexture( GL_TEXTURE1 );
+   glBindTexture( GL_TEXTURE_2D, gtAtlas->lookup );
+   gt_glActiveTexture( GL_TEXTURE0 );
+   glBindTexture( GL_TEXTURE_2D, gtAtlas->texture );
+
+   gt_glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, count );
+   gtGLCalls += 2;  // the clear and the draw
+   gt->frameCounts.glyphs += count;
+
+   gt_glBindVertexArray( 0 );
+   gt_glUseProgram( 0 );
+   gt_glTimerEnd( gt, GT_GPU_SUBMIT );
+}
+
+static bool gt_coreInit( GT *gt, const char *title )
+{
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
+   SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+
+   bool created = gt_glCreateContext( gt, title );
+
+   // The fallback, and legacy windows opened later, ask for whatever context the driver defaults to
+   SDL_GL_ResetAttributes();
+
+   if( created )
+   {
+      if( gt_coreCreate( gt ) )
+      {
+         return T;
+      }
+      gt_coreFree( gt );
+      gt_glDestroy( gt );
+   }
+   return F;
+}
+
+static void gt_coreResize( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+   gt_glMakeCurrent( gt );
+   gt_glBindBuffer( GL_ARRAY_BUFFER, gl->instanceBuffer );
+   gt_glBufferData( GL_ARRAY_BUFFER, sizeof( GTCell ) * gt->cellCols * gt->cellRows, NULL, GL_DYNAMIC_DRAW );
+   gt_glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+// Nothing is retained but the cell buffer, which has to keep mirroring prevCells
+static void gt_coreScroll( GT *gt, int x, int width, int from, int to, int rows )
+{
+   GTGLWindow *gl = gt->backendData;
+
+   UNUSED( x );
+   UNUSED( width );
+
+   gt_glMakeCurrent( gt );
+   gt_glTimerBegin( gt, GT_GPU_SCROLL );
+   gt_glBindBuffer( GL_ARRAY_BUFFER, gl->instanceBuffer );
+   gt_glBufferSubData( GL_ARRAY_BUFFER, sizeof( GTCell ) * MIN( from, to ) * gt->cellCols,
+                       sizeof( GTCell ) * ( rows + abs( to - from ) ) * gt->cellCols, gt->prevCells + MIN( from, to ) * gt->cellCols );
+   gt_glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   gt_glTimerEnd( gt, GT_GPU_SCROLL );
+   gtGLCalls++;
+   gtGLBytes += sizeof( GTCell ) * ( rows + abs( to - from ) ) * gt->cellCols;
+}
+
+static void gt_coreDestroy( GT *gt )
+{
+   gt_glMakeCurrent( gt );
+   gt_coreFree( gt );
+   gt_glDestroy( gt );
+}
+
+const GTBackend gtBackendGLCore =
+{
+   "core",
+   GT_RENDERER_GL_CORE,
+   &gtBackendGLLegacy,
+   gt_coreInit,
+   gt_glBeginFrame,
+   gt_coreResize,
+   gt_coreSubmit,
+   gt_glPresent,
+   gt_coreScroll,
+   gt_glReadPixels,
+   gt_coreDestroy
+};
@@ -0,0 +1,280 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+#ifdef GT_GL_DEBUG
+
+/* ------------------------------------------------------------------------- */
+// GPU timers: every phase of a frame is wrapped in a GL_TIME_ELAPSED query. The queries of a frame are read
+// GT_GPU_FRAMES frames later, when the GPU is done with them, so measuring never stalls the pipeline.
+#define GT_GPU_FRAMES    4
+#define GT_GL_MESSAGES   64   // debug messages kept, older ones are overwritten
+#define GT_GL_MESSAGE    256
+
+static PFNGLGENQUERIESPROC          gt_glGenQueries;
+static PFNGLDELETEQUERIESPROC       gt_glDeleteQueries;
+static PFNGLBEGINQUERYPROC          gt_glBeginQuery;
+static PFNGLENDQUERYPROC            gt_glEndQuery;
+static PFNGLGETQUERYOBJECTIVPROC    gt_glGetQueryObjectiv;
+static PFNGLGETQUERYOBJECTUI64VPROC gt_glGetQueryObjectui64v;
+static PFNGLDEBUGMESSAGECALLBACKPROC gt_glDebugMessageCallback;
+
+struct _GTGLDebug
+{
+   GLuint        queries[ GT_GPU_FRAMES ][ GT_GPU_PHASES ];
+   Uint32        used[ GT_GPU_FRAMES ];                      // bit per phase that ran in the frame
+   int           frame;                                      // slot of the frame being rendered
+   int           running;                                    // phase of the open query, -1 for none
+   bool          timers;                                     // timer queries are available
+   double        phaseMs[ GT_GPU_PHASES ];                   // latest frame read back
+   bool          measured;
+   int           dropped;                                    // frames whose queries were still pending
+
+   SDL_SpinLock  lock;                                       // the callback may run on the render thread
+   char          messages[ GT_GL_MESSAGES ][ GT_GL_MESSAGE ];
+   int           first;                                      // oldest message not read yet
+   int           count;
+};
+
+static bool gt_loadTimerFunctions( void )
+{
+   gt_glGenQueries          = ( PFNGLGENQUERIESPROC ) SDL_GL_GetProcAddress( "glGenQueries" );
+   gt_glDeleteQueries       = ( PFNGLDELETEQUERIESPROC ) SDL_GL_GetProcAddress( "glDeleteQueries" );
+   gt_glBeginQuery          = ( PFNGLBEGINQUERYPROC ) SDL_GL_GetProcAddress( "glBeginQuery" );
+   gt_glEndQuery            = ( PFNGLENDQUERYPROC ) SDL_GL_GetProcAddress( "glEndQuery" );
+   gt_glGetQueryObjectiv    = ( PFNGLGETQUERYOBJECTIVPROC ) SDL_GL_GetProcAddress( "glGetQueryObjectiv" );
+   gt_glGetQueryObjectui64v = ( PFNGLGETQUERYOBJECTUI64VPROC ) SDL_GL_GetProcAddress( "glGetQueryObjectui64v" );
+
+   return ( SDL_GL_ExtensionSupported( "GL_ARB_timer_query" ) || SDL_GL_ExtensionSupported( "GL_EXT_timer_query" ) ) &&
+          gt_glGenQueries && gt_glDeleteQueries && gt_glBeginQuery && gt_glEndQuery &&
+          gt_glGetQueryObjectiv && gt_glGetQueryObjectui64v;
+}
+
+static void APIENTRY gt_glDebugMessage( GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                        const GLchar *message, const void *userParam )
+{
+   GTGLDebug *debug = ( GTGLDebug * ) userParam;
+
+   UNUSED( source );
+   UNUSED( length );
+
+   if( severity == GL_DEBUG_SEVERITY_HIGH )
+   {
+      fprintf( stderr, "OpenGL: %s\n", message );
+   }
+
+   SDL_AtomicLock( &debug->lock );
+   int slot = ( debug->first + debug->count ) % GT_GL_MESSAGES;
+   snprintf( debug->messages[ slot ], GT_GL_MESSAGE, "%s %04x type %04x id %u: %s",
+             severity == GL_DEBUG_SEVERITY_HIGH ? "high" : severity == GL_DEBUG_SEVERITY_MEDIUM ? "medium" :
+             severity == GL_DEBUG_SEVERITY_LOW ? "low" : "note", source, type, id, message );
+   if( debug->count < GT_GL_MESSAGES )
+   {
+      debug->count++;
+   }
+   else
+   {
+      debug->first = ( debug->first + 1 ) % GT_GL_MESSAGES;
+   }
+   SDL_AtomicUnlock( &debug->lock );
+}
+
+// Only windows of the GL renderers have a debug state
+static GTGLDebug *gt_glDebug( GT *gt )
+{
+   if( gt->backend != &gtBackendGLLegacy && gt->backend != &gtBackendGLCore )
+   {
+      return NULL;
+   }
+   return ( ( GTGLWindow * ) gt->backendData )->debug;
+}
+
+/* ------------------------------------------------------------------------- */
+// backend_gl.c and the GL renderers, with the window's context current
+void gt_glDebugInit( GT *gt )
+{
+   GTGLDebug *debug = malloc( sizeof( GTGLDebug ) );
+   if( !debug )
+   {
+      fprintf( stderr, "Memory allocation failed for GL debugging.\n" );
+      return;
+   }
+   memset( debug, 0, sizeof( GTGLDebug ) );
+   debug->running = -1;
+
+   debug->timers = gt_loadTimerFunctions();
+   if( debug->timers )
+   {
+      gt_glGenQueries( GT_GPU_FRAMES * GT_GPU_PHASES, &debug->queries[ 0 ][ 0 ] );
+   }
+   else
+   {
+      fprintf( stderr, "GL timer queries are unavailable, GPU times are not measured.\n" );
+   }
+
+   gt_glDebugMessageCallback = ( PFNGLDEBUGMESSAGECALLBACKPROC ) SDL_GL_GetProcAddress( "glDebugMessageCallback" );
+   if( SDL_GL_ExtensionSupported( "GL_KHR_debug" ) && gt_glDebugMessageCallback )
+   {
+      // Synchronous output reports a message on the thread and in the call that caused it
+      glEnable( GL_DEBUG_OUTPUT );
+      glEnable( GL_DEBUG_OUTPUT_SYNCHRONOUS );
+      gt_glDebugMessageCallback( gt_glDebugMessage, debug );
+   }
+   else
+   {
+      fprintf( stderr, "GL_KHR_debug is unavailable, GL messages are not logged.\n" );
+   }
+
+   ( ( GTGLWindow * ) gt->backendData )->debug = debug;
+}
+
+void gt_glDebugFree( GT *gt )
+{
+   GTGLDebug *debug = gt_glDebug( gt );
+
+   if( !debug )
+   {
+      return;
+   }
+   if( gt_glDebugMessageCallback )
+   {
+      gt_glDebugMessageCallback( NULL, NULL );
+   }
+   if( debug->timers )
+   {
+      gt_glDeleteQueries( GT_GPU_FRAMES * GT_GPU_PHASES, &debug->queries[ 0 ][ 0 ] );
+   }
+   free( debug );
+   ( ( GTGLWindow * ) gt->backendData )->debug = NULL;
+}
+
+// Queries cannot nest, a phase started inside another one is not measured
+void gt_glTimerBegin( GT *gt, GTGpuPhase phase )
+{
+   GTGLDebug *debug = gt_glDebug( gt );
+
+   if( debug && debug->timers && debug->running < 0 )
+   {
+      gt_glBeginQuery( GL_TIME_ELAPSED, debug->queries[ debug->frame ][ phase ] );
+      debug->used[ debug->frame ] |= 1u << phase;
+      debug->running = phase;
+   }
+}
+
+void gt_glTimerEnd( GT *gt, GTGpuPhase phase )
+{
+   GTGLDebug *debug = gt_glDebug( gt );
+
+   if( debug && debug->running == ( int ) phase )
+   {
+      gt_glEndQuery( GL_TIME_ELAPSED );
+      debug->running = -1;
+   }
+}
+
+// After the swap: moves on to the oldest slot and reads its queries if the GPU got through them
+void gt_glTimerFrame( GT *gt )
+{
+   GTGLDebug *debug = gt_glDebug( gt );
+
+   if( !debug || !debug->timers )
+   {
+      return;
+   }
+
+   debug->frame = ( debug->frame + 1 ) % GT_GPU_FRAMES;
+
+   Uint32 used = debug->used[ debug->frame ];
+   if( used == 0 )
+   {
+      return;
+   }
+
+   for( int phase = 0; phase < GT_GPU_PHASES; phase++ )
+   {
+      GLint available = 1;
+      if( used & ( 1u << phase ) )
+      {
+         gt_glGetQueryObjectiv( debug->queries[ debug->frame ][ phase ], GL_QUERY_RESULT_AVAILABLE, &available );
+      }
+      if( !available )
+      {
+         // Waiting would stall the frame, the results are given up
+         debug->dropped++;
+         debug->used[ debug->frame ] = 0;
+         return;
+      }
+   }
+
+   for( int phase = 0; phase < GT_GPU_PHASES; phase++ )
+   {
+      GLuint64 elapsed = 0;
+      if( used & ( 1u << phase ) )
+      {
+         gt_glGetQueryObjectui64v( debug->queries[ debug->frame ][ phase ], GL_QUERY_RESULT, &elapsed );
+      }
+      debug->phaseMs[ phase ] = elapsed / 1000000.0;
+   }
+   debug->used[ debug->frame ] = 0;
+   debug->measured = T;
+}
+
+/* ------------------------------------------------------------------------- */
+// GPU milliseconds per phase of the latest frame read back, a few frames behind the one on screen
+bool gt_getGpuTimes( GT *gt, double phaseMs[ GT_GPU_PHASES ] )
+{
+   GTGLDebug *debug = gt_glDebug( gt );
+
+   if( !debug || !debug->measured || gt->renderThread )
+   {
+      return F;
+   }
+   memcpy( phaseMs, debug->phaseMs, sizeof( debug->phaseMs ) );
+   return T;
+}
+
+// Takes the oldest GL debug message logged for the window, F when there is none
+bool gt_nextGLMessage( GT *gt, char *message, size_t size )
+{
+   GTGLDebug *debug = gt_glDebug( gt );
+   bool found = F;
+
+   if( !debug )
+   {
+      return F;
+   }
+
+   SDL_AtomicLock( &debug->lock );
+   if( debug->count > 0 )
+   {
+      gt_safeCopy( message, debug->messages[ debug->first ], size );
+      debug->first = ( debug->first + 1 ) % GT_GL_MESSAGES;
+      debug->count--;
+      found = T;
+   }
+   SDL_AtomicUnlock( &debug->lock );
+   return found;
+}
+
+#else
+
+/* ------------------------------------------------------------------------- */
+// Builds without GT_GL_DEBUG measure nothing, see docs/README.md
+bool gt_getGpuTimes( GT *gt, double phaseMs[ GT_GPU_PHASES ] )
+{
+   UNUSED( gt );
+   UNUSED( phaseMs );
+   return F;
+}
+
+bool gt_nextGLMessage( GT *gt, char *message, size_t size )
+{
+   UNUSED( gt );
+   UNUSED( message );
+   UNUSED( size );
+   return F;
+}
+
+#endif
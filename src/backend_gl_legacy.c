@@ -0,0 +1,314 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// vertex batch, every quad of a frame is gathered here and drawn with one glDrawArrays()
+#define BATCH_VERTICES 65536
+
+typedef struct
+{
+   GLfloat x, y;
+   GLfloat u, v;
+   GLubyte r, g, b, a;
+} GTVertex;
+
+static GTVertex *gtBatch = NULL;
+static int       gtBatchCount = 0;
+static GLuint    gtBatchBuffer = 0; // 0 = client side arrays
+
+static bool gt_batchInit( void )
+{
+   gtBatch = malloc( sizeof( GTVertex ) * BATCH_VERTICES );
+   if( !gtBatch )
+   {
+      fprintf( stderr, "Memory allocation failed for vertex batch.\n" );
+      return F;
+   }
+   gtBatchCount = 0;
+
+   if( gt_loadBufferFunctions() )
+   {
+      gt_glGenBuffers( 1, &gtBatchBuffer );
+   }
+
+   return T;
+}
+
+static void gt_batchFree( void )
+{
+   if( gtBatchBuffer )
+   {
+      gt_glDeleteBuffers( 1, &gtBatchBuffer );
+      gtBatchBuffer = 0;
+   }
+   free( gtBatch );
+   gtBatch = NULL;
+   gtBatchCount = 0;
+}
+
+static void gt_batchFlush( void )
+{
+   const GLvoid *base = gtBatch;
+
+   if( gtBatchCount == 0 )
+   {
+      return;
+   }
+
+   if( gtBatchBuffer )
+   {
+      gt_glBindBuffer( GL_ARRAY_BUFFER, gtBatchBuffer );
+      gt_glBufferData( GL_ARRAY_BUFFER, sizeof( GTVertex ) * gtBatchCount, gtBatch, GL_STREAM_DRAW );
+      base = NULL;
+   }
+
+   glEnableClientState( GL_VERTEX_ARRAY );
+   glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+   glEnableClientState( GL_COLOR_ARRAY );
+   glVertexPointer( 2, GL_FLOAT, sizeof( GTVertex ), ( const char * ) base + offsetof( GTVertex, x ) );
+   glTexCoordPointer( 2, GL_FLOAT, sizeof( GTVertex ), ( const char * ) base + offsetof( GTVertex, u ) );
+   glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( GTVertex ), ( const char * ) base + offsetof( GTVertex, r ) );
+
+   glDrawArrays( GL_QUADS, 0, gtBatchCount );
+   gtGLCalls += IIF( gtBatchBuffer, 2, 1 );
+   gtGLBytes += sizeof( GTVertex ) * gtBatchCount;
+
+   glDisableClientState( GL_COLOR_ARRAY );
+   glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+   glDisableClientState( GL_VERTEX_ARRAY );
+
+   if( gtBatchBuffer )
+   {
+      gt_glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   }
+
+   gtBatchCount = 0;
+}
+
+// The quad is width x height drawable pixels, the glyph is magnified with GL_NEAREST at integer scales
+static void gt_batchQuad( float x, float y, int width, int height, int slot, gt_color color )
+{
+   if( gtBatchCount + 4 > BATCH_VERTICES )
+   {
+      gt_batchFlush();
+   }
+
+   float u0 = ( float )( ( slot % gtAtlas->cols ) * gtAtlas->font->width ) / ATLAS_SIZE;
+   float v0 = ( float )( ( slot / gtAtlas->cols ) * gtAtlas->font->height ) / ATLAS_SIZE;
+   float u1 = u0 + ( float ) gtAtlas->font->width / ATLAS_SIZE;
+   float v1 = v0 + ( float ) gtAtlas->font->height / ATLAS_SIZE;
+
+   GLubyte r = GT_R( color ), g = GT_G( color ), b = GT_B( color ), a = GT_A( color );
+
+   GTVertex *v = gtBatch + gtBatchCount;
+   v[ 0 ] = ( GTVertex ){ x, y, u0, v0, r, g, b, a };
+   v[ 1 ] = ( GTVertex ){ x + width, y, u1, v0, r, g, b, a };
+   v[ 2 ] = ( GTVertex ){ x + width, y + height, u1, v1, r, g, b, a };
+   v[ 3 ] = ( GTVertex ){ x, y + height, u0, v1, r, g, b, a };
+   gtBatchCount += 4;
+}
+
+// The background uses the solid block in slot 0, so both quads share one texture and one draw call
+static void gt_renderCell( GT *gt, int col, int row, const GTCell *cell )
+{
+   float x = col * gt->cellWidth;
+   float y = row * gt->cellHeight;
+
+   gt_batchQuad( x, y, gt->cellWidth, gt->cellHeight, 0, cell->bg );
+   gt_batchQuad( x, y, gt->cellWidth, gt->cellHeight, gt_atlasGlyph( cell->codepoint ), cell->fg );
+   gt->frameCounts.glyphs++;
+}
+
+/* ------------------------------------------------------------------------- */
+// fixed function OpenGL renderer, changed cells are drawn into a canvas framebuffer that keeps the frame
+static void gt_freeCanvas( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+
+   if( gl->canvasFramebuffer )
+   {
+      gt_glDeleteFramebuffers( 1, &gl->canvasFramebuffer );
+      gl->canvasFramebuffer = 0;
+   }
+   if( gl->canvasTexture )
+   {
+      glDeleteTextures( 1, &gl->canvasTexture );
+      gl->canvasTexture = 0;
+   }
+}
+
+// The canvas keeps the previous frame between buffer swaps, so only changed cells are re-rendered
+static void gt_createCanvas( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+
+   gt_glMakeCurrent( gt );
+   gt_freeCanvas( gt );
+
+   if( !gt_loadFramebufferFunctions() )
+   {
+      return;
+   }
+
+   glGenTextures( 1, &gl->canvasTexture );
+   glBindTexture( GL_TEXTURE_2D, gl->canvasTexture );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, gt->width, gt->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+
+   gt_glGenFramebuffers( 1, &gl->canvasFramebuffer );
+   gt_glBindFramebuffer( GL_FRAMEBUFFER, gl->canvasFramebuffer );
+   gt_glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gl->canvasTexture, 0 );
+
+   if( gt_glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+   {
+      fprintf( stderr, "Canvas framebuffer incomplete, redrawing every frame.\n" );
+      gt_glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+      gt_freeCanvas( gt );
+      return;
+   }
+
+   gt_glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+
+// Renders the changed cells into the canvas and blits it to the back buffer
+static void gt_legacySubmit( GT *gt )
+{
+   GTGLWindow *gl = gt->backendData;
+
+   gt_glMakeCurrent( gt );
+   gt_glTimerBegin( gt, GT_GPU_SUBMIT );
+
+   if( gl->canvasFramebuffer )
+   {
+      gt_glBindFramebuffer( GL_FRAMEBUFFER, gl->canvasFramebuffer );
+   }
+   else
+   {
+      gt->fullRedraw = T;
+      gt_collectDamage( gt );
+   }
+
+   glViewport( 0, 0, gt->width, gt->height );
+
+   glDisable( GL_CULL_FACE );
+   glDisable( GL_DEPTH_TEST );
+   glEnable( GL_BLEND );
+   glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+   glMatrixMode( GL_PROJECTION );
+   glLoadIdentity();
+   glOrtho( 0, gt->width, gt->height, 0, -1, 1 );
+   glMatrixMode( GL_MODELVIEW );
+   glLoadIdentity();
+
+   if( gt->fullRedraw )
+   {
+      gt_clearColor( gt->backgroundColor );
+      glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+   }
+
+   if( ( gtBatch || gt_batchInit() ) && gt_atlasUse( gt ) )
+   {
+      glEnable( GL_TEXTURE_2D );
+      glBindTexture( GL_TEXTURE_2D, gtAtlas->texture );
+
+      // Only cells that differ from the frame on screen are rendered again
+      for( int d = 0; d < gt->damageCount; d++ )
+      {
+         const SDL_Rect *rect = &gt->damage[ d ];
+
+         for( int row = rect->y; row < rect->y + rect->h; row++ )
+         {
+            for( int col = rect->x; col < rect->x + rect->w; col++ )
+            {
+               int i = row * gt->cellCols + col;
+               if( gt->fullRedraw || memcmp( &gt->cells[ i ], &gt->prevCells[ i ], sizeof( GTCell ) ) != 0 )
+               {
+                  gt_renderCell( gt, col, row, &gt->cells[ i ] );
+               }
+            }
+         }
+      }
+      gt_batchFlush();
+      glDisable( GL_TEXTURE_2D );
+   }
+   gt_glTimerEnd( gt, GT_GPU_SUBMIT );
+
+   if( gl->canvasFramebuffer )
+   {
+      gt_glTimerBegin( gt, GT_GPU_BLIT );
+      gt_glBindFramebuffer( GL_READ_FRAMEBUFFER, gl->canvasFramebuffer );
+      gt_glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+      gt_glBlitFramebuffer( 0, 0, gt->width, gt->height, 0, 0, gt->width, gt->height, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+      gt_glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+      gt_glTimerEnd( gt, GT_GPU_BLIT );
+      gtGLCalls++;
+   }
+}
+
+static bool gt_legacyInit( GT *gt, const char *title )
+{
+   return gt_glCreateContext( gt, title );
+}
+
+// GL counts rows from the bottom; overlapping blits within one framebuffer are undefined,
+// so the block goes through the back buffer, which the canvas covers again at present
+static void gt_legacyScroll( GT *gt, int x, int width, int from, int to, int rows )
+{
+   GTGLWindow *gl = gt->backendData;
+
+   if( !gl->canvasFramebuffer )
+   {
+      return;
+   }
+
+   int left   = x * gt->cellWidth;
+   int right  = ( x + width ) * gt->cellWidth;
+   int source = gt->height - ( from + rows ) * gt->cellHeight;
+   int target = gt->height - ( to + rows ) * gt->cellHeight;
+   int span   = rows * gt->cellHeight;
+
+   gt_glMakeCurrent( gt );
+   gt_glTimerBegin( gt, GT_GPU_SCROLL );
+   gt_glBindFramebuffer( GL_READ_FRAMEBUFFER, gl->canvasFramebuffer );
+   gt_glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+   gt_glBlitFramebuffer( left, source, right, source + span, left, source, right, source + span, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+   gt_glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+   gt_glBindFramebuffer( GL_DRAW_FRAMEBUFFER, gl->canvasFramebuffer );
+   gt_glBlitFramebuffer( left, source, right, source + span, left, target, right, target + span, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+   gt_glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+   gt_glTimerEnd( gt, GT_GPU_SCROLL );
+   gtGLCalls += 2;
+}
+
+static void gt_legacyDestroy( GT *gt )
+{
+   gt_glMakeCurrent( gt );
+   gt_freeCanvas( gt );
+   if( !gt_otherWindow( gt, gt->backend ) )
+   {
+      // The batch buffer belongs to the context group
+      gt_batchFree();
+   }
+   gt_glDestroy( gt );
+}
+
+const GTBackend gtBackendGLLegacy =
+{
+   "legacy",
+   GT_RENDERER_GL_LEGACY,
+   &gtBackendSoftware,
+   gt_legacyInit,
+   gt_glBeginFrame,
+   gt_createCanvas,
+   gt_legacySubmit,
+   gt_glPresent,
+   gt_legacyScroll,
+   gt_glReadPixels,
+   gt_legacyDestroy
+};
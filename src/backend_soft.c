@@ -0,0 +1,540 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// software renderer, cells are expanded straight from the font bitmaps into a 32-bit XRGB buffer
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+   #include <immintrin.h>
+   #define GT_X86_SIMD
+#endif
+
+typedef void ( *GTBlitCell )( Uint32 *dst, int pitch, const Uint16 *bitmap, int width, int height, Uint32 fg, Uint32 bg );
+
+// gt_color is 0xRRGGBBAA, the pixel buffer is 0x00RRGGBB; fg alpha is blended over bg once per cell
+static Uint32 gt_softPixel( gt_color color, gt_color under )
+{
+   Uint32 a = GT_A( color );
+   Uint32 r = ( GT_R( color ) * a + GT_R( under ) * ( 255 - a ) ) / 255;
+   Uint32 g = ( GT_G( color ) * a + GT_G( under ) * ( 255 - a ) ) / 255;
+   Uint32 b = ( GT_B( color ) * a + GT_B( under ) * ( 255 - a ) ) / 255;
+
+   return ( r << 16 ) | ( g << 8 ) | b;
+}
+
+static void gt_blitCellScalar( Uint32 *dst, int pitch, const Uint16 *bitmap, int width, int height, Uint32 fg, Uint32 bg )
+{
+   for( int row = 0; row < height; row++, dst += pitch )
+   {
+      unsigned int value = bitmap[ row ];
+      for( int col = 0; col < width; col++ )
+      {
+         dst[ col ] = ( value & ( 0x8000 >> col ) ) ? fg : bg;
+      }
+   }
+}
+
+#ifdef GT_X86_SIMD
+// One 4-lane select mask for every nibble of a glyph row, most significant bit first
+static const Uint32 gtNibbleMask[ 16 ][ 4 ] __attribute__(( aligned( 16 ) )) =
+{
+   { 0, 0, 0, 0 }, { 0, 0, 0, ~0u }, { 0, 0, ~0u, 0 }, { 0, 0, ~0u, ~0u },
+   { 0, ~0u, 0, 0 }, { 0, ~0u, 0, ~0u }, { 0, ~0u, ~0u, 0 }, { 0, ~0u, ~0u, ~0u },
+   { ~0u, 0, 0, 0 }, { ~0u, 0, 0, ~0u }, { ~0u, 0, ~0u, 0 }, { ~0u, 0, ~0u, ~0u },
+   { ~0u, ~0u, 0, 0 }, { ~0u, ~0u, 0, ~0u }, { ~0u, ~0u, ~0u, 0 }, { ~0u, ~0u, ~0u, ~0u }
+};
+
+__attribute__(( target( "sse2" ) ))
+static void gt_blitCellSSE2( Uint32 *dst, int pitch, const Uint16 *bitmap, int width, int height, Uint32 fg, Uint32 bg )
+{
+   __m128i fg4 = _mm_set1_epi32( ( int ) fg );
+   __m128i bg4 = _mm_set1_epi32( ( int ) bg );
+
+   for( int row = 0; row < height; row++, dst += pitch )
+   {
+      unsigned int value = bitmap[ row ];
+      __m128i m0 = _mm_load_si128( ( const __m128i * ) gtNibbleMask[ ( value >> 12 ) & 0xF ] );
+      __m128i m1 = _mm_load_si128( ( const __m128i * ) gtNibbleMask[ ( value >> 8 ) & 0xF ] );
+
+      _mm_storeu_si128( ( __m128i * )( dst ),     _mm_or_si128( _mm_and_si128( m0, fg4 ), _mm_andnot_si128( m0, bg4 ) ) );
+      _mm_storeu_si128( ( __m128i * )( dst + 4 ), _mm_or_si128( _mm_and_si128( m1, fg4 ), _mm_andnot_si128( m1, bg4 ) ) );
+      for( int col = 8; col < width; col++ )
+      {
+         dst[ col ] = ( value & ( 0x8000 >> col ) ) ? fg : bg;
+      }
+   }
+}
+
+__attribute__(( target( "avx2" ) ))
+static void gt_blitCellAVX2( Uint32 *dst, int pitch, const Uint16 *bitmap, int width, int height, Uint32 fg, Uint32 bg )
+{
+   const __m256i bits = _mm256_setr_epi32( 0x8000, 0x4000, 0x2000, 0x1000, 0x0800, 0x0400, 0x0200, 0x0100 );
+   __m256i fg8 = _mm256_set1_epi32( ( int ) fg );
+   __m256i bg8 = _mm256_set1_epi32( ( int ) bg );
+
+   for( int row = 0; row < height; row++, dst += pitch )
+   {
+      unsigned int value = bitmap[ row ];
+      __m256i mask = _mm256_cmpeq_epi32( _mm256_and_si256( _mm256_set1_epi32( ( int ) value ), bits ), bits );
+
+      _mm256_storeu_si256( ( __m256i * ) dst, _mm256_blendv_epi8( bg8, fg8, mask ) );
+      for( int col = 8; col < width; col++ )
+      {
+         dst[ col ] = ( value & ( 0x8000 >> col ) ) ? fg : bg;
+      }
+   }
+}
+#endif
+
+// The vector kernels write the first 8 columns at once and finish wider cells one pixel at a time
+static GTBlitCell gt_softKernel( int width )
+{
+#ifdef GT_X86_SIMD
+   if( width >= 8 )
+   {
+      if( SDL_HasAVX2() )
+      {
+         return gt_blitCellAVX2;
+      }
+      else if( SDL_HasSSE2() )
+      {
+         return gt_blitCellSSE2;
+      }
+   }
+#endif
+   return gt_blitCellScalar;
+}
+
+// Scaled glyphs are byte masks, 0xFF where the glyph is set, so any cell width is a plain select
+typedef void ( *GTBlitMask )( Uint32 *dst, int pitch, const Uint8 *mask, int width, int height, Uint32 fg, Uint32 bg );
+
+static void gt_blitMaskScalar( Uint32 *dst, int pitch, const Uint8 *mask, int width, int height, Uint32 fg, Uint32 bg )
+{
+   for( int row = 0; row < height; row++, dst += pitch, mask += width )
+   {
+      for( int col = 0; col < width; col++ )
+      {
+         Uint32 select = ( Uint32 )( Sint32 )( Sint8 ) mask[ col ];
+         dst[ col ] = ( fg & select ) | ( bg & ~select );
+      }
+   }
+}
+
+#ifdef GT_X86_SIMD
+__attribute__(( target( "sse2" ) ))
+static void gt_blitMaskSSE2( Uint32 *dst, int pitch, const Uint8 *mask, int width, int height, Uint32 fg, Uint32 bg )
+{
+   __m128i fg4 = _mm_set1_epi32( ( int ) fg );
+   __m128i bg4 = _mm_set1_epi32( ( int ) bg );
+
+   for( int row = 0; row < height; row++, dst += pitch, mask += width )
+   {
+      int col = 0;
+      for( ; col + 4 <= width; col += 4 )
+      {
+         int bytes;
+         memcpy( &bytes, mask + col, sizeof( bytes ) );
+
+         // Widen each mask byte to a whole pixel: 0xFF -> 0xFFFF -> 0xFFFFFFFF
+         __m128i m = _mm_cvtsi32_si128( bytes );
+         m = _mm_unpacklo_epi8( m, m );
+         m = _mm_unpacklo_epi16( m, m );
+
+         _mm_storeu_si128( ( __m128i * )( dst + col ), _mm_or_si128( _mm_and_si128( m, fg4 ), _mm_andnot_si128( m, bg4 ) ) );
+      }
+      for( ; col < width; col++ )
+      {
+         dst[ col ] = mask[ col ] ? fg : bg;
+      }
+   }
+}
+#endif
+
+static GTBlitMask gt_softMaskKernel( void )
+{
+#ifdef GT_X86_SIMD
+   if( SDL_HasSSE2() )
+   {
+      return gt_blitMaskSSE2;
+   }
+#endif
+   return gt_blitMaskScalar;
+}
+
+/* ------------------------------------------------------------------------- */
+// one cache per integer scale, a glyph is magnified the first time it is drawn at that scale;
+// zooming back to a scale seen before only looks glyphs up again
+typedef struct
+{
+   const GTFont *font;
+   int          *slot;      // per font glyph, -1 = not magnified yet
+   Uint8        *masks;     // count glyphs of ( width * scale ) x ( height * scale ) bytes
+   int           count;
+   int           capacity;
+} GTScaledGlyphs;
+
+static GTScaledGlyphs gtScaledGlyphs[ GT_MAX_SCALE + 1 ];  // 1x draws straight from the font bitmaps
+
+static void gt_scaledReset( GTScaledGlyphs *cache )
+{
+   free( cache->slot );
+   free( cache->masks );
+   memset( cache, 0, sizeof( GTScaledGlyphs ) );
+}
+
+static void gt_scaledFree( void )
+{
+   for( int scale = 0; scale <= GT_MAX_SCALE; scale++ )
+   {
+      gt_scaledReset( &gtScaledGlyphs[ scale ] );
+   }
+}
+
+// Returns the magnified mask of a glyph, NULL if memory ran out
+static const Uint8 *gt_scaledGlyph( const GTFont *font, int scale, unsigned int codepoint )
+{
+   GTScaledGlyphs *cache = &gtScaledGlyphs[ scale ];
+   const Uint16 *bitmap = gt_glyphLookup( font, codepoint );
+   int glyph  = ( int )( ( bitmap - font->glyphs ) / font->height );
+   int width  = font->width * scale;
+   size_t size = ( size_t ) width * font->height * scale;
+
+   if( cache->font != font )
+   {
+      gt_scaledReset( cache );
+
+      cache->slot = malloc( sizeof( int ) * font->glyphCount );
+      if( !cache->slot )
+      {
+         fprintf( stderr, "Memory allocation failed for scaled glyphs.\n" );
+         return NULL;
+      }
+      memset( cache->slot, 0xFF, sizeof( int ) * font->glyphCount );
+      cache->font = font;
+   }
+
+   if( cache->slot[ glyph ] < 0 )
+   {
+      if( cache->count == cache->capacity )
+      {
+         int capacity = IIF( cache->capacity > 0, cache->capacity * 2, 128 );
+         Uint8 *masks = realloc( cache->masks, size * capacity );
+         if( !masks )
+         {
+            fprintf( stderr, "Memory allocation failed for scaled glyphs.\n" );
+            return NULL;
+         }
+         cache->masks    = masks;
+         cache->capacity = capacity;
+      }
+
+      Uint8 *mask = cache->masks + size * cache->count;
+      for( int row = 0; row < font->height; row++ )
+      {
+         Uint8 *line = mask + ( size_t ) row * scale * width;
+         for( int col = 0; col < font->width; col++ )
+         {
+            memset( line + col * scale, IIF( bitmap[ row ] & ( 0x8000 >> col ), 0xFF, 0x00 ), scale );
+         }
+         for( int copy = 1; copy < scale; copy++ )
+         {
+            memcpy( line + copy * width, line, width );
+         }
+      }
+      cache->slot[ glyph ] = cache->count++;
+   }
+
+   return cache->masks + size * cache->slot[ glyph ];
+}
+
+// gt->backendData of software and headless windows
+typedef struct
+{
+   Uint32      *pixels;   // cellCols * cellWidth wide, whole cells
+   SDL_Surface *frame;    // the pixels as a surface, blitted to the window
+} GTSoftWindow;
+
+static GTSoftWindow *gt_softCreate( void )
+{
+   GTSoftWindow *soft = calloc( 1, sizeof( GTSoftWindow ) );
+   if( !soft )
+   {
+      fprintf( stderr, "Memory allocation failed for software renderer.\n" );
+   }
+   return soft;
+}
+
+static void gt_softFree( GT *gt )
+{
+   GTSoftWindow *soft = gt->backendData;
+
+   if( soft->frame )
+   {
+      SDL_FreeSurface( soft->frame );
+      soft->frame = NULL;
+   }
+   free( soft->pixels );
+   soft->pixels = NULL;
+}
+
+// The buffer covers whole cells, the window only shows its top-left width x height pixels
+static void gt_softResize( GT *gt )
+{
+   GTSoftWindow *soft = gt->backendData;
+   int pitch = gt->cellCols * gt->cellWidth;
+   int lines = gt->cellRows * gt->cellHeight;
+
+   gt_softFree( gt );
+
+   soft->pixels = malloc( sizeof( Uint32 ) * pitch * lines );
+   if( !soft->pixels )
+   {
+      fprintf( stderr, "Memory allocation failed for pixel buffer.\n" );
+      return;
+   }
+
+   soft->frame = SDL_CreateRGBSurfaceWithFormatFrom( soft->pixels, pitch, lines, 32, pitch * sizeof( Uint32 ), SDL_PIXELFORMAT_RGB888 );
+   if( !soft->frame )
+   {
+      fprintf( stderr, "SDL_CreateRGBSurfaceWithFormatFrom failed: %s\n", SDL_GetError() );
+   }
+}
+
+static void gt_softRender( GT *gt )
+{
+   GTSoftWindow *soft = gt->backendData;
+
+   if( !soft->pixels )
+   {
+      return;
+   }
+
+   int pitch = gt->cellCols * gt->cellWidth;
+   GTBlitCell blitCell = gt_softKernel( gt->cellWidth );
+   GTBlitMask blitMask = gt_softMaskKernel();
+
+   for( int d = 0; d < gt->damageCount; d++ )
+   {
+      const SDL_Rect *rect = &gt->damage[ d ];
+
+      for( int row = rect->y; row < rect->y + rect->h; row++ )
+      {
+         Uint32 *line = soft->pixels + row * gt->cellHeight * pitch;
+
+         for( int col = rect->x; col < rect->x + rect->w; col++ )
+         {
+            int i = row * gt->cellCols + col;
+            if( gt->fullRedraw || memcmp( &gt->cells[ i ], &gt->prevCells[ i ], sizeof( GTCell ) ) != 0 )
+            {
+               const GTCell *cell = &gt->cells[ i ];
+               Uint32 fg = gt_softPixel( cell->fg, cell->bg );
+               Uint32 bg = gt_softPixel( cell->bg, cell->bg );
+               gt->frameCounts.glyphs++;
+
+               if( gt->scale == 1 )
+               {
+                  blitCell( line + col * gt->cellWidth, pitch, gt_glyphLookup( gt->font, cell->codepoint ), gt->cellWidth, gt->cellHeight, fg, bg );
+               }
+               else
+               {
+                  const Uint8 *mask = gt_scaledGlyph( gt->font, gt->scale, cell->codepoint );
+                  if( mask )
+                  {
+                     blitMask( line + col * gt->cellWidth, pitch, mask, gt->cellWidth, gt->cellHeight, fg, bg );
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
+static SDL_Rect gt_damagePixels( GT *gt, const SDL_Rect *cells )
+{
+   SDL_Rect rect;
+
+   rect.x = cells->x * gt->cellWidth;
+   rect.y = cells->y * gt->cellHeight;
+   rect.w = MIN( cells->w * gt->cellWidth, gt->width - rect.x );
+   rect.h = MIN( cells->h * gt->cellHeight, gt->height - rect.y );
+
+   return rect;
+}
+
+// Copies only the damaged rectangles to the window surface and tells SDL which ones changed
+static void gt_softPresent( GT *gt )
+{
+   GTSoftWindow *soft = gt->backendData;
+   SDL_Rect rects[ GT_MAX_DAMAGE ];
+   int count = 0;
+
+   SDL_Surface *surface = SDL_GetWindowSurface( gt->window );
+   if( !surface || !soft->frame )
+   {
+      return;
+   }
+
+   if( gt->fullRedraw )
+   {
+      SDL_BlitSurface( soft->frame, NULL, surface, NULL );
+      SDL_UpdateWindowSurface( gt->window );
+      gt->frameCounts.bytesUploaded += ( size_t ) gt->width * gt->height * sizeof( Uint32 );
+      return;
+   }
+
+   for( int d = 0; d < gt->damageCount; d++ )
+   {
+      SDL_Rect rect = gt_damagePixels( gt, &gt->damage[ d ] );
+      if( rect.w > 0 && rect.h > 0 )
+      {
+         SDL_Rect dest = rect;
+         SDL_BlitSurface( soft->frame, &rect, surface, &dest );
+         rects[ count++ ] = rect;
+         gt->frameCounts.bytesUploaded += ( size_t ) rect.w * rect.h * sizeof( Uint32 );
+      }
+   }
+   if( count > 0 )
+   {
+      SDL_UpdateWindowSurfaceRects( gt->window, rects, count );
+   }
+}
+
+static bool gt_softInit( GT *gt, const char *title )
+{
+   GTSoftWindow *soft = gt_softCreate();
+   if( !soft )
+   {
+      return F;
+   }
+
+   // No GL context at all, frames are presented through the window surface
+   if( !gt_openWindow( gt, title, 0 ) )
+   {
+      free( soft );
+      return F;
+   }
+   gt->backendData = soft;
+   return T;
+}
+
+static void gt_softBeginFrame( GT *gt, int *width, int *height )
+{
+   SDL_GetWindowSize( gt->window, width, height );
+}
+
+// Moves whole pixel lines, in the direction that never overwrites a line before it was moved
+static void gt_softScroll( GT *gt, int x, int width, int from, int to, int rows )
+{
+   GTSoftWindow *soft = gt->backendData;
+
+   if( !soft->pixels )
+   {
+      return;
+   }
+
+   int pitch = gt->cellCols * gt->cellWidth;
+   int lines = rows * gt->cellHeight;
+   int step  = IIF( to > from, -1, 1 );
+   int first = IIF( to > from, lines - 1, 0 );
+
+   for( int i = 0, line = first; i < lines; i++, line += step )
+   {
+      memcpy( soft->pixels + ( to * gt->cellHeight + line ) * pitch + x * gt->cellWidth,
+              soft->pixels + ( from * gt->cellHeight + line ) * pitch + x * gt->cellWidth,
+              sizeof( Uint32 ) * width * gt->cellWidth );
+   }
+}
+
+static bool gt_softReadPixels( GT *gt, int x, int y, int width, int height, gt_color *pixels )
+{
+   GTSoftWindow *soft = gt->backendData;
+
+   if( !soft->pixels )
+   {
+      return F;
+   }
+
+   int pitch = gt->cellCols * gt->cellWidth;
+   for( int row = 0; row < height; row++ )
+   {
+      const Uint32 *src = soft->pixels + ( y + row ) * pitch + x;
+      for( int col = 0; col < width; col++ )
+      {
+         pixels[ row * width + col ] = ( src[ col ] << 8 ) | 0xFF;
+      }
+   }
+   return T;
+}
+
+static void gt_softDestroy( GT *gt )
+{
+   gt_softFree( gt );
+   free( gt->backendData );
+   gt->backendData = NULL;
+   if( !gt_otherWindow( gt, &gtBackendSoftware ) && !gt_otherWindow( gt, &gtBackendHeadless ) )
+   {
+      gt_scaledFree();
+   }
+   gt_closeWindow( gt );
+}
+
+const GTBackend gtBackendSoftware =
+{
+   "software",
+   GT_RENDERER_SOFTWARE,
+   NULL,
+   gt_softInit,
+   gt_softBeginFrame,
+   gt_softResize,
+   gt_softRender,
+   gt_softPresent,
+   gt_softScroll,
+   gt_softReadPixels,
+   gt_softDestroy
+};
+
+/* ------------------------------------------------------------------------- */
+// headless, the software renderer without a window
+static bool gt_headlessInit( GT *gt, const char *title )
+{
+   UNUSED( title );
+
+   // Events only, so programs can still poll or push SDL events
+   if( SDL_Init( SDL_INIT_EVENTS ) != 0 )
+   {
+      fprintf( stderr, "Unable to initialize SDL: %s\n", SDL_GetError() );
+      return F;
+   }
+
+   gt->backendData = gt_softCreate();
+   return gt->backendData != NULL;
+}
+
+// The offscreen frame keeps the size it was created with
+static void gt_headlessBeginFrame( GT *gt, int *width, int *height )
+{
+   *width  = gt->width;
+   *height = gt->height;
+}
+
+static void gt_headlessPresent( GT *gt )
+{
+   UNUSED( gt );
+}
+
+const GTBackend gtBackendHeadless =
+{
+   "headless",
+   GT_RENDERER_HEADLESS,
+   NULL,
+   gt_headlessInit,
+   gt_headlessBeginFrame,
+   gt_softResize,
+   gt_softRender,
+   gt_headlessPresent,
+   gt_softScroll,
+   gt_softReadPixels,
+   gt_softDestroy
+};
@@ -0,0 +1,879 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// terminal renderer, one GT cell is one character cell of the terminal on stdout. A frame is written as
+// the escape sequences that turn what the terminal shows, gt->prevCells, into gt->cells.
+#define GT_TERM_REPRINT   8   // unchanged characters written again instead of a cursor move, at most
+#define GT_TERM_ESCAPE_MS 30  // an ESC not followed by more within this time is the Escape key
+
+// Terminals that know synchronized updates show a frame only once all of it arrived
+static const char gtSyncBegin[] = "\x1b[?2026h";
+static const char gtSyncEnd[]   = "\x1b[?2026l";
+
+// gt->backendData of the terminal window
+typedef struct
+{
+   char    *out;          // sequences of the frame, written by gt_termPresent()
+   size_t   length;
+   size_t   capacity;
+   Uint8   *changed;      // per column of the row being written
+   int      row;          // cursor position, row -1 when it is not known
+   int      col;
+   Uint32   fg;           // colors set by the last SGR, see gt_termColor()
+   Uint32   bg;
+   bool     colorsKnown;
+   bool     trueColor;    // 24-bit SGR colors, otherwise the nearest of the 256 xterm colors
+   SDL_Rect stale;        // cells the terminal no longer shows as gt->prevCells says, see gt_termScroll()
+   SDL_Thread  *input;    // gt_termInput(), NULL when stdin is not a terminal
+   SDL_atomic_t quit;
+   SDL_atomic_t resized;  // set by gt_termInput(), taken by gt_termResized()
+} GTTerminal;
+
+// Every frame starts with gtSyncBegin
+static void gt_termAppend( GTTerminal *term, const char *bytes, size_t length )
+{
+   size_t begin = IIF( term->length == 0, sizeof( gtSyncBegin ) - 1, 0 );
+
+   if( term->length + begin + length > term->capacity )
+   {
+      size_t capacity = MAX( term->capacity * 2, term->length + begin + length );
+      char *out = realloc( term->out, capacity );
+      if( !out )
+      {
+         fprintf( stderr, "Memory allocation failed for terminal output.\n" );
+         return;
+      }
+      term->out      = out;
+      term->capacity = capacity;
+   }
+   memcpy( term->out + term->length, gtSyncBegin, begin );
+   term->length += begin;
+   memcpy( term->out + term->length, bytes, length );
+   term->length += length;
+}
+
+static void gt_termFormat( GTTerminal *term, const char *format, ... )
+{
+   char sequence[ 64 ];
+   va_list args;
+
+   va_start( args, format );
+   int length = vsnprintf( sequence, sizeof( sequence ), format, args );
+   va_end( args );
+
+   gt_termAppend( term, sequence, ( size_t ) MIN( length, ( int ) sizeof( sequence ) - 1 ) );
+}
+
+static int gt_termUtf8( unsigned int codepoint, char *bytes )
+{
+   if( codepoint < 0x80 )
+   {
+      bytes[ 0 ] = ( char ) codepoint;
+      return 1;
+   }
+   else if( codepoint < 0x800 )
+   {
+      bytes[ 0 ] = ( char )( 0xC0 | ( codepoint >> 6 ) );
+      bytes[ 1 ] = ( char )( 0x80 | ( codepoint & 0x3F ) );
+      return 2;
+   }
+   else if( codepoint < 0x10000 )
+   {
+      bytes[ 0 ] = ( char )( 0xE0 | ( codepoint >> 12 ) );
+      bytes[ 1 ] = ( char )( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+      bytes[ 2 ] = ( char )( 0x80 | ( codepoint & 0x3F ) );
+      return 3;
+   }
+   bytes[ 0 ] = ( char )( 0xF0 | ( codepoint >> 18 ) );
+   bytes[ 1 ] = ( char )( 0x80 | ( ( codepoint >> 12 ) & 0x3F ) );
+   bytes[ 2 ] = ( char )( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+   bytes[ 3 ] = ( char )( 0x80 | ( codepoint & 0x3F ) );
+   return 4;
+}
+
+// A wide character followed by its blank right half, the only way the terminal can show it
+static bool gt_termWide( const GTCell *line, int col, int cols )
+{
+   return col + 1 < cols && gt_charWidth( line[ col ].codepoint ) == 2 &&
+          line[ col + 1 ].codepoint == ' ' && line[ col + 1 ].fg == line[ col ].fg && line[ col + 1 ].bg == line[ col ].bg;
+}
+
+// What is written for a cell: controls, zero-width and invalid codepoints would move the cursor or merge with
+// their neighbour, they get the replacement character; half a wide character is a blank
+static unsigned int gt_termGlyph( const GTCell *line, int col, int cols )
+{
+   unsigned int codepoint = line[ col ].codepoint;
+
+   if( codepoint == 0 )
+   {
+      return ' ';
+   }
+   if( codepoint < 0x20 || ( codepoint >= 0x7F && codepoint < 0xA0 ) || ( codepoint >= 0xD800 && codepoint < 0xE000 ) ||
+       codepoint >= 0x110000 || gt_charWidth( codepoint ) == 0 )
+   {
+      return 0xFFFD;
+   }
+   if( gt_charWidth( codepoint ) == 2 && !gt_termWide( line, col, cols ) )
+   {
+      return ' ';
+   }
+   return codepoint;
+}
+
+/* ------------------------------------------------------------------------- */
+// colors, fg alpha is blended over bg the way the software renderer does it
+static Uint32 gt_termNearest256( Uint32 r, Uint32 g, Uint32 b )
+{
+   static const Uint32 level[ 6 ] = { 0, 95, 135, 175, 215, 255 };
+
+   // 6x6x6 cube from index 16, 24 grays from index 232
+   Uint32 ri = IIF( r < 48, 0, IIF( r < 115, 1, ( r - 35 ) / 40 ) );
+   Uint32 gi = IIF( g < 48, 0, IIF( g < 115, 1, ( g - 35 ) / 40 ) );
+   Uint32 bi = IIF( b < 48, 0, IIF( b < 115, 1, ( b - 35 ) / 40 ) );
+   Uint32 average = ( r + g + b ) / 3;
+   Uint32 grayIndex = IIF( average > 238, 23, IIF( average < 8, 0, ( average - 3 ) / 10 ) );
+   Uint32 gray = 8 + 10 * grayIndex;
+
+   int dr = ( int ) r - ( int ) level[ ri ], dg = ( int ) g - ( int ) level[ gi ], db = ( int ) b - ( int ) level[ bi ];
+   int cubeDistance = dr * dr + dg * dg + db * db;
+   dr = ( int ) r - ( int ) gray, dg = ( int ) g - ( int ) gray, db = ( int ) b - ( int ) gray;
+   int grayDistance = dr * dr + dg * dg + db * db;
+
+   return IIF( grayDistance < cubeDistance, 232 + grayIndex, 16 + 36 * ri + 6 * gi + bi );
+}
+
+// 0xRRGGBB for truecolor terminals, a palette index for the others; equal values are the same SGR
+static Uint32 gt_termColor( const GTTerminal *term, gt_color color, gt_color under )
+{
+   Uint32 a = GT_A( color );
+   Uint32 r = ( GT_R( color ) * a + GT_R( under ) * ( 255 - a ) ) / 255;
+   Uint32 g = ( GT_G( color ) * a + GT_G( under ) * ( 255 - a ) ) / 255;
+   Uint32 b = ( GT_B( color ) * a + GT_B( under ) * ( 255 - a ) ) / 255;
+
+   if( term->trueColor )
+   {
+      return ( r << 16 ) | ( g << 8 ) | b;
+   }
+   return gt_termNearest256( r, g, b );
+}
+
+// One SGR for both colors, only the ones that differ from what the terminal draws with already
+static void gt_termSetColors( GTTerminal *term, Uint32 fg, Uint32 bg )
+{
+   bool setFg = !term->colorsKnown || fg != term->fg;
+   bool setBg = !term->colorsKnown || bg != term->bg;
+   char sgr[ 64 ];
+   int length = 0;
+
+   if( !setFg && !setBg )
+   {
+      return;
+   }
+
+   length += sprintf( sgr + length, "\x1b[" );
+   if( setFg )
+   {
+      length += IIF( term->trueColor, sprintf( sgr + length, "38;2;%u;%u;%u", fg >> 16, ( fg >> 8 ) & 0xFF, fg & 0xFF ),
+                                      sprintf( sgr + length, "38;5;%u", fg ) );
+   }
+   if( setBg )
+   {
+      length += IIF( term->trueColor, sprintf( sgr + length, "%s48;2;%u;%u;%u", IIF( setFg, ";", "" ), bg >> 16, ( bg >> 8 ) & 0xFF, bg & 0xFF ),
+                                      sprintf( sgr + length, "%s48;5;%u", IIF( setFg, ";", "" ), bg ) );
+   }
+   sgr[ length++ ] = 'm';
+
+   gt_termAppend( term, sgr, length );
+   term->fg = fg;
+   term->bg = bg;
+   term->colorsKnown = T;
+}
+
+/* ------------------------------------------------------------------------- */
+// cursor movement, the shortest of an absolute position and the relative moves that get there
+
+// Along the cursor's row; a few unchanged narrow characters in the current colors are often shorter than CUF
+static int gt_termHorizontal( GTTerminal *term, const GTCell *line, int cols, int from, int to, char *move )
+{
+   int gap = to - from;
+   int length;
+
+   if( gap <= 0 )
+   {
+      return IIF( gap == 0, 0, -1 );
+   }
+
+   length = IIF( gap == 1, sprintf( move, "\x1b[C" ), sprintf( move, "\x1b[%dC", gap ) );
+
+   // After a vertical move the cursor may sit on the right half of a wide character, which must not be written
+   if( gap <= GT_TERM_REPRINT && term->colorsKnown && !( from > 0 && gt_termWide( line, from - 1, cols ) ) )
+   {
+      char text[ 4 * GT_TERM_REPRINT ];
+      int textLength = 0;
+
+      for( int col = from; col < to; col++ )
+      {
+         unsigned int codepoint = gt_termGlyph( line, col, cols );
+         if( codepoint != line[ col ].codepoint || gt_charWidth( codepoint ) != 1 ||
+             gt_termColor( term, line[ col ].fg, line[ col ].bg ) != term->fg || gt_termColor( term, line[ col ].bg, line[ col ].bg ) != term->bg )
+         {
+            return length;
+         }
+         textLength += gt_termUtf8( codepoint, text + textLength );
+      }
+      if( textLength < length )
+      {
+         memcpy( move, text, textLength );
+         length = textLength;
+      }
+   }
+   return length;
+}
+
+static void gt_termMoveTo( GTTerminal *term, const GTCell *line, int cols, int row, int col )
+{
+   char best[ 64 ], move[ 64 ];
+   int bestLength, length;
+
+   if( term->row == row && term->col == col )
+   {
+      return;
+   }
+
+   if( col == 0 )
+   {
+      bestLength = IIF( row == 0, sprintf( best, "\x1b[H" ), sprintf( best, "\x1b[%dH", row + 1 ) );
+   }
+   else
+   {
+      bestLength = sprintf( best, "\x1b[%d;%dH", row + 1, col + 1 );
+   }
+
+   if( term->row == row )
+   {
+      length = gt_termHorizontal( term, line, cols, term->col, col, move );
+      if( length >= 0 && length < bestLength )
+      {
+         memcpy( best, move, length );
+         bestLength = length;
+      }
+   }
+   else if( term->row >= 0 && term->row < row )
+   {
+      int down = row - term->row;
+
+      // CR LF to the start of a following row
+      if( down <= 4 )
+      {
+         length = 0;
+         for( int i = 0; i < down; i++ )
+         {
+            move[ length++ ] = '\r';
+            move[ length++ ] = '\n';
+         }
+         int horizontal = gt_termHorizontal( term, line, cols, 0, col, move + length );
+         if( horizontal >= 0 && length + horizontal < bestLength )
+         {
+            memcpy( best, move, length + horizontal );
+            bestLength = length + horizontal;
+         }
+      }
+
+      // CUD, then along the row
+      length = IIF( down == 1, sprintf( move, "\x1b[B" ), sprintf( move, "\x1b[%dB", down ) );
+      int horizontal = gt_termHorizontal( term, line, cols, term->col, col, move + length );
+      if( horizontal >= 0 && length + horizontal < bestLength )
+      {
+         memcpy( best, move, length + horizontal );
+         bestLength = length + horizontal;
+      }
+   }
+
+   gt_termAppend( term, best, bestLength );
+   term->row = row;
+   term->col = col;
+}
+
+/* ------------------------------------------------------------------------- */
+// frames
+static bool gt_termStale( const GTTerminal *term, int row, int col )
+{
+   return term->stale.w > 0 && col >= term->stale.x && col < term->stale.x + term->stale.w &&
+          row >= term->stale.y && row < term->stale.y + term->stale.h;
+}
+
+static void gt_termRow( GT *gt, GTTerminal *term, int row )
+{
+   int cols = gt->cellCols;
+   const GTCell *line = gt->cells + row * cols;
+   const GTCell *prev = gt->prevCells + row * cols;
+   Uint8 *changed = term->changed;
+
+   for( int col = 0; col < cols; col++ )
+   {
+      changed[ col ] = gt->fullRedraw || memcmp( &line[ col ], &prev[ col ], sizeof( GTCell ) ) != 0 || gt_termStale( term, row, col );
+   }
+
+   // Writing either half of a wide character blanks the other half as well
+   for( int col = 0; col < cols - 1; col++ )
+   {
+      if( ( changed[ col ] || changed[ col + 1 ] ) && gt_termWide( prev, col, cols ) )
+      {
+         changed[ col ] = changed[ col + 1 ] = T;
+      }
+   }
+
+   for( int col = 0; col < cols; )
+   {
+      int span = IIF( gt_termWide( line, col, cols ), 2, 1 );
+
+      if( changed[ col ] || ( span == 2 && changed[ col + 1 ] ) )
+      {
+         char bytes[ 4 ];
+         const GTCell *cell = &line[ col ];
+
+         gt_termMoveTo( term, line, cols, row, col );
+         gt_termSetColors( term, gt_termColor( term, cell->fg, cell->bg ), gt_termColor( term, cell->bg, cell->bg ) );
+         gt_termAppend( term, bytes, gt_termUtf8( gt_termGlyph( line, col, cols ), bytes ) );
+         gt->frameCounts.glyphs++;
+
+         // Autowrap is off, but where the cursor stays after the last column differs between terminals
+         term->col += span;
+         if( term->col >= cols )
+         {
+            term->row = -1;
+         }
+      }
+      col += span;
+   }
+}
+
+static void gt_termSubmit( GT *gt )
+{
+   GTTerminal *term = gt->backendData;
+
+   if( !term->changed )
+   {
+      return;
+   }
+
+   if( gt->fullRedraw )
+   {
+      term->row = -1;
+      term->colorsKnown = F;
+   }
+
+   // Damage rectangles may share rows, every row is written once
+   for( int row = 0; row < gt->cellRows; row++ )
+   {
+      bool damaged = gt->fullRedraw;
+      for( int d = 0; d < gt->damageCount && !damaged; d++ )
+      {
+         damaged = row >= gt->damage[ d ].y && row < gt->damage[ d ].y + gt->damage[ d ].h;
+      }
+      if( damaged )
+      {
+         gt_termRow( gt, term, row );
+      }
+   }
+   term->stale.w = 0;
+}
+
+// The frame goes out in one write, output the program left in stdout's buffer before it
+static void gt_termPresent( GT *gt )
+{
+   GTTerminal *term = gt->backendData;
+
+   if( term->length == 0 )
+   {
+      return;
+   }
+
+   gt_termAppend( term, gtSyncEnd, sizeof( gtSyncEnd ) - 1 );
+
+   fflush( stdout );
+   gt_terminalWrite( term->out, term->length );
+   gt->frameCounts.bytesUploaded += term->length;
+   term->length = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+// input: a thread reads what is typed into the terminal and pushes it the way SDL reports a window's keyboard,
+// as SDL_KEYDOWN, SDL_TEXTINPUT and SDL_KEYUP events with window ID 0. Terminals do not report releases, so every
+// key is released right after it was pressed. A resize pushes SDL_WINDOWEVENT_SIZE_CHANGED with the size in cells.
+typedef struct
+{
+   char         final;     // last byte of the CSI or SS3 sequence
+   int          number;    // first parameter of sequences ending in '~'
+   SDL_Keycode  sym;
+   SDL_Scancode scancode;
+   Uint16       mod;
+} GTTermKey;
+
+static const GTTermKey gtTermKeys[] =
+{
+   { 'A',  0, SDLK_UP,       SDL_SCANCODE_UP,       0 },
+   { 'B',  0, SDLK_DOWN,     SDL_SCANCODE_DOWN,     0 },
+   { 'C',  0, SDLK_RIGHT,    SDL_SCANCODE_RIGHT,    0 },
+   { 'D',  0, SDLK_LEFT,     SDL_SCANCODE_LEFT,     0 },
+   { 'H',  0, SDLK_HOME,     SDL_SCANCODE_HOME,     0 },
+   { 'F',  0, SDLK_END,      SDL_SCANCODE_END,      0 },
+   { 'Z',  0, SDLK_TAB,      SDL_SCANCODE_TAB,      KMOD_LSHIFT },
+   { 'P',  0, SDLK_F1,       SDL_SCANCODE_F1,       0 },
+   { 'Q',  0, SDLK_F2,       SDL_SCANCODE_F2,       0 },
+   { 'R',  0, SDLK_F3,       SDL_SCANCODE_F3,       0 },
+   { 'S',  0, SDLK_F4,       SDL_SCANCODE_F4,       0 },
+   { '~',  1, SDLK_HOME,     SDL_SCANCODE_HOME,     0 },
+   { '~',  2, SDLK_INSERT,   SDL_SCANCODE_INSERT,   0 },
+   { '~',  3, SDLK_DELETE,   SDL_SCANCODE_DELETE,   0 },
+   { '~',  4, SDLK_END,      SDL_SCANCODE_END,      0 },
+   { '~',  5, SDLK_PAGEUP,   SDL_SCANCODE_PAGEUP,   0 },
+   { '~',  6, SDLK_PAGEDOWN, SDL_SCANCODE_PAGEDOWN, 0 },
+   { '~',  7, SDLK_HOME,     SDL_SCANCODE_HOME,     0 },
+   { '~',  8, SDLK_END,      SDL_SCANCODE_END,      0 },
+   { '~', 11, SDLK_F1,       SDL_SCANCODE_F1,       0 },
+   { '~', 12, SDLK_F2,       SDL_SCANCODE_F2,       0 },
+   { '~', 13, SDLK_F3,       SDL_SCANCODE_F3,       0 },
+   { '~', 14, SDLK_F4,       SDL_SCANCODE_F4,       0 },
+   { '~', 15, SDLK_F5,       SDL_SCANCODE_F5,       0 },
+   { '~', 17, SDLK_F6,       SDL_SCANCODE_F6,       0 },
+   { '~', 18, SDLK_F7,       SDL_SCANCODE_F7,       0 },
+   { '~', 19, SDLK_F8,       SDL_SCANCODE_F8,       0 },
+   { '~', 20, SDLK_F9,       SDL_SCANCODE_F9,       0 },
+   { '~', 21, SDLK_F10,      SDL_SCANCODE_F10,      0 },
+   { '~', 23, SDLK_F11,      SDL_SCANCODE_F11,      0 },
+   { '~', 24, SDLK_F12,      SDL_SCANCODE_F12,      0 },
+};
+
+// ESC [ number ; modifiers final, or ESC O final; unknown sequences leave sym at SDLK_UNKNOWN
+static void gt_termSequence( const char *params, int length, char final, SDL_Keysym *key )
+{
+   int number = 0, modifiers = 0, field = 0;
+
+   for( int i = 0; i < length; i++ )
+   {
+      if( params[ i ] >= '0' && params[ i ] <= '9' && field < 2 )
+      {
+         int *value = IIF( field == 0, &number, &modifiers );
+         *value = *value * 10 + params[ i ] - '0';
+      }
+      else if( params[ i ] == ';' )
+      {
+         field++;
+      }
+      else
+      {
+         // Private parameters, e.g. mouse reports, which are never turned on
+         return;
+      }
+   }
+
+   for( size_t k = 0; k < LEN( gtTermKeys ); k++ )
+   {
+      if( gtTermKeys[ k ].final == final && ( final != '~' || gtTermKeys[ k ].number == number ) )
+      {
+         key->sym      = gtTermKeys[ k ].sym;
+         key->scancode = gtTermKeys[ k ].scancode;
+         key->mod      = gtTermKeys[ k ].mod;
+         break;
+      }
+   }
+
+   // xterm sends 1 + a bit mask of Shift, Alt and Ctrl
+   if( modifiers > 1 )
+   {
+      key->mod |= IIF( ( modifiers - 1 ) & 1, KMOD_LSHIFT, 0 ) | IIF( ( modifiers - 1 ) & 2, KMOD_LALT, 0 ) |
+                  IIF( ( modifiers - 1 ) & 4, KMOD_LCTRL, 0 );
+   }
+}
+
+// Decodes the key at the start of input. Returns the bytes it took, 0 when more have to be read first unless
+// complete says nothing more is coming. text gets the UTF-8 of a typed character, empty for other keys.
+static int gt_termDecode( const char *input, int length, bool complete, SDL_Keysym *key, char *text )
+{
+   const unsigned char *in = ( const unsigned char * ) input;
+
+   memset( key, 0, sizeof( SDL_Keysym ) );
+   text[ 0 ] = '\0';
+
+   if( in[ 0 ] == 0x1B )
+   {
+      if( length == 1 )
+      {
+         if( !complete )
+         {
+            return 0;
+         }
+         key->sym      = SDLK_ESCAPE;
+         key->scancode = SDL_SCANCODE_ESCAPE;
+         return 1;
+      }
+
+      if( ( in[ 1 ] == '[' || in[ 1 ] == 'O' ) && !( length == 2 && complete ) )
+      {
+         // CSI takes parameter bytes before its final byte, SS3 only the final byte
+         int end = 2;
+         while( in[ 1 ] == '[' && end < length && in[ end ] >= 0x20 && in[ end ] <= 0x3F )
+         {
+            end++;
+         }
+         if( end == length )
+         {
+            // Cut off, dropped once nothing more comes
+            return IIF( complete, length, 0 );
+         }
+         gt_termSequence( input + 2, end - 2, input[ end ], key );
+         return end + 1;
+      }
+
+      // ESC before a key is Alt
+      int used = gt_termDecode( input + 1, length - 1, complete, key, text );
+      if( used == 0 )
+      {
+         return 0;
+      }
+      key->mod |= KMOD_LALT;
+      text[ 0 ] = '\0';
+      return used + 1;
+   }
+
+   if( in[ 0 ] == '\r' || in[ 0 ] == '\n' )
+   {
+      key->sym      = SDLK_RETURN;
+      key->scancode = SDL_SCANCODE_RETURN;
+      return 1;
+   }
+   if( in[ 0 ] == '\t' )
+   {
+      key->sym      = SDLK_TAB;
+      key->scancode = SDL_SCANCODE_TAB;
+      return 1;
+   }
+   if( in[ 0 ] == 0x7F || in[ 0 ] == 0x08 )
+   {
+      key->sym      = SDLK_BACKSPACE;
+      key->scancode = SDL_SCANCODE_BACKSPACE;
+      return 1;
+   }
+   if( in[ 0 ] < 0x20 )
+   {
+      // Ctrl+A is 0x01, Ctrl+Space is 0x00
+      int c = in[ 0 ] + 0x40;
+      key->sym = IIF( c == '@', ' ', IIF( c >= 'A' && c <= 'Z', c + 32, c ) );
+      key->mod = KMOD_LCTRL;
+      if( key->sym >= 'a' && key->sym <= 'z' )
+      {
+         key->scancode = SDL_SCANCODE_A + ( key->sym - 'a' );
+      }
+      return 1;
+   }
+
+   int size = IIF( in[ 0 ] < 0x80, 1, IIF( in[ 0 ] >= 0xF0, 4, IIF( in[ 0 ] >= 0xE0, 3, IIF( in[ 0 ] >= 0xC0, 2, 0 ) ) ) );
+   if( size == 0 )
+   {
+      // A continuation byte without its lead byte
+      return 1;
+   }
+   if( size > length )
+   {
+      return IIF( complete, length, 0 );
+   }
+   memcpy( text, input, size );
+   text[ size ] = '\0';
+
+   if( size == 1 )
+   {
+      // Keycodes of character keys are the unshifted characters
+      int c = in[ 0 ];
+      key->sym = IIF( c >= 'A' && c <= 'Z', c + 32, c );
+      key->mod = IIF( c >= 'A' && c <= 'Z', KMOD_LSHIFT, 0 );
+      if( key->sym >= 'a' && key->sym <= 'z' )
+      {
+         key->scancode = SDL_SCANCODE_A + ( key->sym - 'a' );
+      }
+      else if( c >= '1' && c <= '9' )
+      {
+         key->scancode = SDL_SCANCODE_1 + ( c - '1' );
+      }
+      else if( c == '0' )
+      {
+         key->scancode = SDL_SCANCODE_0;
+      }
+      else if( c == ' ' )
+      {
+         key->scancode = SDL_SCANCODE_SPACE;
+      }
+   }
+   return size;
+}
+
+static void gt_termPushKey( const SDL_Keysym *key, const char *text )
+{
+   SDL_Event event;
+
+   if( key->sym != SDLK_UNKNOWN )
+   {
+      memset( &event, 0, sizeof( event ) );
+      event.key.type      = SDL_KEYDOWN;
+      event.key.timestamp = SDL_GetTicks();
+      event.key.state     = SDL_PRESSED;
+      event.key.keysym    = *key;
+      SDL_PushEvent( &event );
+   }
+   if( text[ 0 ] )
+   {
+      memset( &event, 0, sizeof( event ) );
+      event.text.type      = SDL_TEXTINPUT;
+      event.text.timestamp = SDL_GetTicks();
+      gt_safeCopy( event.text.text, text, sizeof( event.text.text ) );
+      SDL_PushEvent( &event );
+   }
+   if( key->sym != SDLK_UNKNOWN )
+   {
+      memset( &event, 0, sizeof( event ) );
+      event.key.type      = SDL_KEYUP;
+      event.key.timestamp = SDL_GetTicks();
+      event.key.state     = SDL_RELEASED;
+      event.key.keysym    = *key;
+      SDL_PushEvent( &event );
+   }
+}
+
+static void gt_termPushResize( GTTerminal *term )
+{
+   SDL_Event event;
+   int cols = 0, rows = 0;
+
+   SDL_AtomicSet( &term->resized, 1 );
+   gt_terminalSize( &cols, &rows );
+
+   // Also wakes a program waiting in gt_waitEvent(), gt_frameDue() then asks for the frame
+   memset( &event, 0, sizeof( event ) );
+   event.window.type      = SDL_WINDOWEVENT;
+   event.window.timestamp = SDL_GetTicks();
+   event.window.event     = SDL_WINDOWEVENT_SIZE_CHANGED;
+   event.window.data1     = cols;
+   event.window.data2     = rows;
+   SDL_PushEvent( &event );
+}
+
+static int gt_termInput( void *data )
+{
+   GTTerminal *term = data;
+   char input[ 256 ];
+   int length = 0;
+   Uint32 deadline = 0;  // bytes still undecoded then are taken as they are
+
+   while( !SDL_AtomicGet( &term->quit ) )
+   {
+      bool resized;
+      int timeout = IIF( length > 0, MAX( ( int )( deadline - SDL_GetTicks() ), 0 ), -1 );
+      int count = gt_terminalRead( input + length, sizeof( input ) - length, timeout, &resized );
+      if( count < 0 )
+      {
+         break;
+      }
+      if( resized )
+      {
+         gt_termPushResize( term );
+      }
+      if( count > 0 )
+      {
+         length += count;
+         deadline = SDL_GetTicks() + GT_TERM_ESCAPE_MS;
+      }
+
+      bool complete = length == sizeof( input ) || SDL_TICKS_PASSED( SDL_GetTicks(), deadline );
+      int offset = 0;
+      while( offset < length )
+      {
+         SDL_Keysym key;
+         char text[ 5 ];
+         int used = gt_termDecode( input + offset, length - offset, complete, &key, text );
+         if( used == 0 )
+         {
+            break;
+         }
+         gt_termPushKey( &key, text );
+         offset += used;
+      }
+      memmove( input, input + offset, length - offset );
+      length -= offset;
+   }
+   return 0;
+}
+
+// T once after the terminal was resized, what it shows then is no longer known; called by gt_frameDue()
+bool gt_termResized( GT *gt )
+{
+   GTTerminal *term = gt->backendData;
+   return SDL_AtomicSet( &term->resized, 0 ) != 0;
+}
+
+/* ------------------------------------------------------------------------- */
+// backend
+static bool gt_termInit( GT *gt, const char *title )
+{
+   UNUSED( title );
+
+   if( gt_otherWindow( gt, &gtBackendTerminal ) )
+   {
+      fprintf( stderr, "The terminal already shows another window.\n" );
+      return F;
+   }
+
+   // Events only, keys come from gt_termInput(); SDL still turns Ctrl+C into SDL_QUIT
+   if( SDL_Init( SDL_INIT_EVENTS ) != 0 )
+   {
+      fprintf( stderr, "Unable to initialize SDL: %s\n", SDL_GetError() );
+      return F;
+   }
+
+   GTTerminal *term = malloc( sizeof( GTTerminal ) );
+   if( !term )
+   {
+      fprintf( stderr, "Memory allocation failed for terminal.\n" );
+      return F;
+   }
+   memset( term, 0, sizeof( GTTerminal ) );
+   term->row = -1;
+   gt->backendData = term;
+
+   const char *colorTerm = getenv( "COLORTERM" );
+   term->trueColor = colorTerm && ( strcmp( colorTerm, "truecolor" ) == 0 || strcmp( colorTerm, "24bit" ) == 0 );
+
+   // A character cell cannot be magnified
+   gt->autoScale = F;
+
+   if( gt_terminalOpen() )
+   {
+      term->input = SDL_CreateThread( gt_termInput, "gt terminal input", term );
+      if( !term->input )
+      {
+         fprintf( stderr, "Unable to read the terminal's keys: %s\n", SDL_GetError() );
+      }
+   }
+
+   // Alternate screen, hidden cursor, no autowrap
+   static const char enter[] = "\x1b[?1049h\x1b[?25l\x1b[?7l";
+   fflush( stdout );
+   gt_terminalWrite( enter, sizeof( enter ) - 1 );
+   return T;
+}
+
+// The grid follows the terminal, COLUMNS x LINES or 80 x 24 when stdout is not one
+static void gt_termBeginFrame( GT *gt, int *width, int *height )
+{
+   int cols, rows;
+
+   if( !gt_terminalSize( &cols, &rows ) )
+   {
+      const char *columns = getenv( "COLUMNS" );
+      const char *lines   = getenv( "LINES" );
+
+      cols = IIF( columns && atoi( columns ) > 0, atoi( columns ), 80 );
+      rows = IIF( lines && atoi( lines ) > 0, atoi( lines ), 24 );
+   }
+
+   *width  = cols * gt->font->width * gt->scale;
+   *height = rows * gt->font->height * gt->scale;
+}
+
+static void gt_termResize( GT *gt )
+{
+   GTTerminal *term = gt->backendData;
+
+   free( term->changed );
+   term->changed = malloc( gt->cellCols );
+   if( !term->changed )
+   {
+      fprintf( stderr, "Memory allocation failed for terminal.\n" );
+   }
+   term->stale.w = 0;
+   term->row = -1;
+}
+
+// Whole lines scroll inside the terminal with a scrolling region; the terminal blanks the lines it exposes.
+// Narrower regions cannot be moved, the cells stay stale and are written again by the next gt_termSubmit().
+static void gt_termScroll( GT *gt, int x, int width, int from, int to, int rows )
+{
+   GTTerminal *term = gt->backendData;
+   int top    = MIN( from, to );
+   int bottom = MAX( from, to ) + rows;
+   SDL_Rect area = { x, top, width, bottom - top };
+
+   if( x == 0 && width == gt->cellCols && !SDL_HasIntersection( &term->stale, &area ) )
+   {
+      gt_termFormat( term, "\x1b[%d;%dr\x1b[%d%c\x1b[r", top + 1, bottom, abs( to - from ), IIF( to < from, 'S', 'T' ) );
+      term->row = -1;
+
+      area.y = IIF( to < from, to + rows, top );
+      area.h = abs( to - from );
+   }
+
+   if( term->stale.w > 0 )
+   {
+      SDL_UnionRect( &term->stale, &area, &term->stale );
+   }
+   else
+   {
+      term->stale = area;
+   }
+}
+
+static bool gt_termReadPixels( GT *gt, int x, int y, int width, int height, gt_color *pixels )
+{
+   UNUSED( gt );
+   UNUSED( x );
+   UNUSED( y );
+   UNUSED( width );
+   UNUSED( height );
+   UNUSED( pixels );
+
+   fprintf( stderr, "The terminal renderer has no pixels to read.\n" );
+   return F;
+}
+
+static void gt_termDestroy( GT *gt )
+{
+   GTTerminal *term = gt->backendData;
+
+   if( term )
+   {
+      if( term->input )
+      {
+         SDL_AtomicSet( &term->quit, 1 );
+         gt_terminalWake();
+         SDL_WaitThread( term->input, NULL );
+      }
+
+      static const char leave[] = "\x1b[0m\x1b[?7h\x1b[?25h\x1b[?1049l";
+      fflush( stdout );
+      gt_terminalWrite( leave, sizeof( leave ) - 1 );
+      gt_terminalClose();
+
+      free( term->out );
+      free( term->changed );
+      free( term );
+      gt->backendData = NULL;
+   }
+}
+
+const GTBackend gtBackendTerminal =
+{
+   "terminal",
+   GT_RENDERER_TERMINAL,
+   NULL,
+   gt_termInit,
+   gt_termBeginFrame,
+   gt_termResize,
+   gt_termSubmit,
+   gt_termPresent,
+   gt_termScroll,
+   gt_termReadPixels,
+   gt_termDestroy
+};
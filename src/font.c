@@ -0,0 +1,629 @@
+/*
+ *
+ */
+
+#include "gt.h"
+
+#include <sys/stat.h>
+
+/* ------------------------------------------------------------------------- */
+// lookup
+bool gt_glyphExists( const GTFont *font, unsigned int codepoint )
+{
+   return codepoint < 0x10000 && ( font->coverage[ codepoint >> 5 ] >> ( codepoint & 31 ) ) & 1;
+}
+
+// Returns the font->height rows of a glyph, bits 15..( 16 - font->width ) from left to right;
+// codepoints without a glyph, including everything beyond the BMP, get the fallback glyph
+const Uint16 *gt_glyphLookup( const GTFont *font, unsigned int codepoint )
+{
+   if( !gt_glyphExists( font, codepoint ) )
+   {
+      return font->glyphs + font->fallback * font->height;
+   }
+   return font->glyphs + font->blocks[ font->pages[ codepoint >> 8 ] * 256 + ( codepoint & 0xFF ) ] * font->height;
+}
+
+/* ------------------------------------------------------------------------- */
+// cache file, the same sparse layout as the built-in font preceded by a header; it is mapped
+// read-only, so every process using the font shares one copy of its pages
+#define FONT_CACHE_MAGIC 0x31465447 // "GTF1"
+
+typedef struct
+{
+   Uint32 magic;
+   Uint32 width;
+   Uint32 height;
+   Uint32 glyphCount;
+   Uint32 blockCount;
+   Uint32 fallback;
+   Uint64 sourceSize;
+   Sint64 sourceTime;
+   // Uint32 coverage[ 0x10000 / 32 ], Uint16 pages[ 256 ], Uint16 blocks[ blockCount ][ 256 ], Uint16 glyphs[ glyphCount ][ height ]
+} GTFontHeader;
+
+static size_t gt_fontCacheSize( Uint32 height, Uint32 glyphCount, Uint32 blockCount )
+{
+   return sizeof( GTFontHeader ) + sizeof( Uint32 ) * 0x10000 / 32 + sizeof( Uint16 ) * 256 +
+          sizeof( Uint16 ) * 256 * blockCount + sizeof( Uint16 ) * height * glyphCount;
+}
+
+// Points the font into a cache image, after checking that the image is complete
+static bool gt_fontAttach( GTFont *font, void *data, size_t size )
+{
+   const GTFontHeader *header = data;
+
+   if( size < sizeof( GTFontHeader ) || header->magic != FONT_CACHE_MAGIC ||
+       header->width == 0 || header->width > GT_FONT_MAX_WIDTH || header->height == 0 || header->height > GT_FONT_MAX_HEIGHT ||
+       header->glyphCount == 0 || header->blockCount == 0 || header->fallback >= header->glyphCount ||
+       size != gt_fontCacheSize( header->height, header->glyphCount, header->blockCount ) )
+   {
+      return F;
+   }
+
+   const Uint8 *p = ( const Uint8 * ) data + sizeof( GTFontHeader );
+
+   font->width      = header->width;
+   font->height     = header->height;
+   font->glyphCount = header->glyphCount;
+   font->fallback   = header->fallback;
+   font->coverage   = ( const Uint32 * ) p;
+   p += sizeof( Uint32 ) * 0x10000 / 32;
+   font->pages      = ( const Uint16 * ) p;
+   p += sizeof( Uint16 ) * 256;
+   font->blocks     = ( const Uint16 * ) p;
+   p += sizeof( Uint16 ) * 256 * header->blockCount;
+   font->glyphs     = ( const Uint16 * ) p;
+
+   for( int i = 0; i < 256; i++ )
+   {
+      if( font->pages[ i ] >= header->blockCount )
+      {
+         return F;
+      }
+   }
+   for( Uint32 i = 0; i < 256 * header->blockCount; i++ )
+   {
+      if( font->blocks[ i ] >= header->glyphCount )
+      {
+         return F;
+      }
+   }
+
+   font->data = data;
+   font->size = size;
+   return T;
+}
+
+// A cache image is only used for the font file it was made from, after gt_fontAttach() accepted it
+static bool gt_fontCurrent( const void *data, const struct stat *source )
+{
+   const GTFontHeader *header = data;
+
+   return header->sourceSize == ( Uint64 ) source->st_size && header->sourceTime == source->st_mtime;
+}
+
+/* ------------------------------------------------------------------------- */
+// builder, glyphs parsed from BDF or PSF2 are collected here before they are laid out as a cache image
+typedef struct
+{
+   int     width;
+   int     height;
+   int     glyphCount;
+   int     glyphCapacity;
+   Uint16 *glyphs;        // glyphCapacity x height rows
+   Uint16  glyphOf[ 0x10000 ];
+   Uint32  coverage[ 0x10000 / 32 ];
+   int     defaultChar;   // -1 = none
+} GTFontBuilder;
+
+static Uint16 *gt_builderGlyph( GTFontBuilder *builder )
+{
+   if( builder->glyphCount == 0x10000 )
+   {
+      fprintf( stderr, "Font has more than 65536 glyphs.\n" );
+      return NULL;
+   }
+
+   if( builder->glyphCount == builder->glyphCapacity )
+   {
+      int capacity = IIF( builder->glyphCapacity == 0, 256, builder->glyphCapacity * 2 );
+      Uint16 *glyphs = realloc( builder->glyphs, sizeof( Uint16 ) * builder->height * capacity );
+      if( !glyphs )
+      {
+         fprintf( stderr, "Memory allocation failed for font glyphs.\n" );
+         return NULL;
+      }
+      builder->glyphs = glyphs;
+      builder->glyphCapacity = capacity;
+   }
+
+   Uint16 *rows = builder->glyphs + builder->glyphCount++ * builder->height;
+   memset( rows, 0, sizeof( Uint16 ) * builder->height );
+   return rows;
+}
+
+static void gt_builderMap( GTFontBuilder *builder, unsigned int codepoint, int glyph )
+{
+   if( codepoint < 0x10000 )
+   {
+      builder->glyphOf[ codepoint ] = glyph;
+      builder->coverage[ codepoint >> 5 ] |= 1u << ( codepoint & 31 );
+   }
+}
+
+static bool gt_builderHas( const GTFontBuilder *builder, unsigned int codepoint )
+{
+   return codepoint < 0x10000 && ( builder->coverage[ codepoint >> 5 ] >> ( codepoint & 31 ) ) & 1;
+}
+
+static void *gt_builderLayout( const GTFontBuilder *builder, size_t *size, const struct stat *source )
+{
+   Uint16 pages[ 256 ];
+   Uint32 blockCount = 1; // block 0 is the empty page
+
+   for( int page = 0; page < 256; page++ )
+   {
+      pages[ page ] = 0;
+      for( int i = 0; i < 256 / 32; i++ )
+      {
+         if( builder->coverage[ page * 256 / 32 + i ] )
+         {
+            pages[ page ] = blockCount++;
+            break;
+         }
+      }
+   }
+
+   // U+FFFD, then the font's DEFAULT_CHAR, then '?'
+   Uint32 fallback = 0;
+   if( gt_builderHas( builder, 0xFFFD ) )
+   {
+      fallback = builder->glyphOf[ 0xFFFD ];
+   }
+   else if( builder->defaultChar >= 0 && gt_builderHas( builder, builder->defaultChar ) )
+   {
+      fallback = builder->glyphOf[ builder->defaultChar ];
+   }
+   else if( gt_builderHas( builder, '?' ) )
+   {
+      fallback = builder->glyphOf[ '?' ];
+   }
+
+   *size = gt_fontCacheSize( builder->height, builder->glyphCount, blockCount );
+   Uint8 *data = calloc( 1, *size );
+   if( !data )
+   {
+      fprintf( stderr, "Memory allocation failed for font cache.\n" );
+      return NULL;
+   }
+
+   GTFontHeader *header = ( GTFontHeader * ) data;
+   header->magic      = FONT_CACHE_MAGIC;
+   header->width      = builder->width;
+   header->height     = builder->height;
+   header->glyphCount = builder->glyphCount;
+   header->blockCount = blockCount;
+   header->fallback   = fallback;
+   header->sourceSize = source->st_size;
+   header->sourceTime = source->st_mtime;
+
+   Uint8 *p = data + sizeof( GTFontHeader );
+   memcpy( p, builder->coverage, sizeof( builder->coverage ) );
+   p += sizeof( builder->coverage );
+   memcpy( p, pages, sizeof( pages ) );
+   p += sizeof( pages );
+
+   Uint16 *blocks = ( Uint16 * ) p;
+   for( int page = 0; page < 256; page++ )
+   {
+      if( pages[ page ] )
+      {
+         memcpy( blocks + pages[ page ] * 256, builder->glyphOf + page * 256, sizeof( Uint16 ) * 256 );
+      }
+   }
+   p += sizeof( Uint16 ) * 256 * blockCount;
+
+   memcpy( p, builder->glyphs, sizeof( Uint16 ) * builder->height * builder->glyphCount );
+
+   return data;
+}
+
+/* ------------------------------------------------------------------------- */
+// BDF
+static const char *gt_bdfLine( const char *p, const char *end, char *line, size_t lineSize )
+{
+   size_t len = 0;
+
+   while( p < end && *p != '\n' )
+   {
+      if( len + 1 < lineSize && *p != '\r' )
+      {
+         line[ len++ ] = *p;
+      }
+      p++;
+   }
+   line[ len ] = '\0';
+
+   return IIF( p < end, p + 1, p );
+}
+
+static bool gt_parseBDF( GTFontBuilder *builder, const char *text, size_t size )
+{
+   const char *p = text, *end = text + size;
+   char line[ 256 ];
+   int fontW = 0, fontH = 0, fontX = 0, fontY = 0;
+   int ascent = -1, descent = -1;
+   unsigned int encoding = 0;
+   int w = 0, h = 0, x = 0, y = 0;
+   bool validEncoding = F;
+
+   while( p < end )
+   {
+      p = gt_bdfLine( p, end, line, sizeof( line ) );
+
+      if( sscanf( line, "FONTBOUNDINGBOX %d %d %d %d", &fontW, &fontH, &fontX, &fontY ) == 4 )
+      {
+         continue;
+      }
+      if( sscanf( line, "FONT_ASCENT %d", &ascent ) == 1 || sscanf( line, "FONT_DESCENT %d", &descent ) == 1 ||
+          sscanf( line, "DEFAULT_CHAR %d", &builder->defaultChar ) == 1 )
+      {
+         continue;
+      }
+      if( strncmp( line, "CHARS ", 6 ) == 0 )
+      {
+         // Glyphs follow, the cell is known now
+         builder->width  = fontW;
+         builder->height = IIF( ascent >= 0 && descent >= 0, ascent + descent, fontH );
+         if( ascent < 0 )
+         {
+            ascent = fontH + fontY;
+         }
+         if( builder->width <= 0 || builder->width > GT_FONT_MAX_WIDTH || builder->height <= 0 || builder->height > GT_FONT_MAX_HEIGHT )
+         {
+            fprintf( stderr, "BDF cell %dx%d is not supported, at most %dx%d.\n", builder->width, builder->height, GT_FONT_MAX_WIDTH, GT_FONT_MAX_HEIGHT );
+            return F;
+         }
+         continue;
+      }
+      if( strncmp( line, "ENCODING ", 9 ) == 0 )
+      {
+         int value = -1;
+         sscanf( line, "ENCODING %d", &value );
+         validEncoding = value >= 0 && value < 0x10000;
+         encoding = value;
+         continue;
+      }
+      if( sscanf( line, "BBX %d %d %d %d", &w, &h, &x, &y ) == 4 )
+      {
+         continue;
+      }
+      if( strcmp( line, "BITMAP" ) == 0 )
+      {
+         Uint16 *rows = NULL;
+
+         if( builder->height == 0 )
+         {
+            fprintf( stderr, "BDF glyphs before CHARS.\n" );
+            return F;
+         }
+         if( validEncoding )
+         {
+            rows = gt_builderGlyph( builder );
+            if( !rows )
+            {
+               return F;
+            }
+            gt_builderMap( builder, encoding, builder->glyphCount - 1 );
+         }
+
+         int top  = ascent - y - h;
+         int left = x - fontX;
+         for( int row = 0; row < h && p < end; row++ )
+         {
+            p = gt_bdfLine( p, end, line, sizeof( line ) );
+
+            // Hex digits are left aligned, keep the leftmost 16 pixels
+            unsigned long bits = strtoul( line, NULL, 16 );
+            int digits = ( int ) strlen( line );
+            Uint32 value = IIF( digits <= 4, bits << ( 4 * ( 4 - digits ) ), bits >> ( 4 * ( digits - 4 ) ) );
+
+            if( rows && top + row >= 0 && top + row < builder->height )
+            {
+               value = IIF( left >= 0, value >> left, value << -left );
+               rows[ top + row ] = ( Uint16 )( value & ( 0xFFFF << ( 16 - builder->width ) ) );
+            }
+         }
+         validEncoding = F;
+      }
+   }
+
+   if( builder->glyphCount == 0 )
+   {
+      fprintf( stderr, "BDF font has no glyphs.\n" );
+      return F;
+   }
+   return T;
+}
+
+/* ------------------------------------------------------------------------- */
+// PSF2
+#define PSF2_MAGIC       0x864AB572
+#define PSF2_HAS_UNICODE 0x01
+
+static Uint32 gt_le32( const Uint8 *p )
+{
+   return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) | ( ( Uint32 ) p[ 3 ] << 24 );
+}
+
+static bool gt_parsePSF2( GTFontBuilder *builder, const Uint8 *data, size_t size )
+{
+   if( size < 32 || gt_le32( data ) != PSF2_MAGIC )
+   {
+      return F;
+   }
+
+   Uint32 headerSize = gt_le32( data + 8 );
+   Uint32 flags      = gt_le32( data + 12 );
+   Uint32 length     = gt_le32( data + 16 );
+   Uint32 charSize   = gt_le32( data + 20 );
+   Uint32 height     = gt_le32( data + 24 );
+   Uint32 width      = gt_le32( data + 28 );
+   Uint32 rowBytes   = ( width + 7 ) / 8;
+
+   if( width == 0 || width > GT_FONT_MAX_WIDTH || height == 0 || height > GT_FONT_MAX_HEIGHT )
+   {
+      fprintf( stderr, "PSF2 cell %ux%u is not supported, at most %dx%d.\n", width, height, GT_FONT_MAX_WIDTH, GT_FONT_MAX_HEIGHT );
+      return F;
+   }
+   if( charSize != rowBytes * height || length == 0 || length > 0x10000 || headerSize > size ||
+       ( size - headerSize ) / charSize < length )
+   {
+      fprintf( stderr, "PSF2 font is truncated.\n" );
+      return F;
+   }
+
+   builder->width  = width;
+   builder->height = height;
+
+   for( Uint32 i = 0; i < length; i++ )
+   {
+      const Uint8 *glyph = data + headerSize + i * charSize;
+      Uint16 *rows = gt_builderGlyph( builder );
+      if( !rows )
+      {
+         return F;
+      }
+      for( Uint32 row = 0; row < height; row++ )
+      {
+         const Uint8 *bytes = glyph + row * rowBytes;
+         rows[ row ] = ( Uint16 )( ( ( bytes[ 0 ] << 8 ) | IIF( rowBytes > 1, bytes[ 1 ], 0 ) ) & ( 0xFFFF << ( 16 - width ) ) );
+      }
+   }
+
+   if( !( flags & PSF2_HAS_UNICODE ) )
+   {
+      for( Uint32 i = 0; i < length; i++ )
+      {
+         gt_builderMap( builder, i, i );
+      }
+      return T;
+   }
+
+   // Per glyph: UTF-8 codepoints, optional 0xFE-prefixed sequences that are skipped, then 0xFF
+   const Uint8 *p = data + headerSize + length * charSize, *end = data + size;
+   for( Uint32 i = 0; i < length && p < end; i++ )
+   {
+      bool sequence = F;
+
+      while( p < end && *p != 0xFF )
+      {
+         if( *p == 0xFE )
+         {
+            sequence = T;
+            p++;
+            continue;
+         }
+
+         unsigned int codepoint = *p++;
+         int extra = IIF( codepoint >= 0xF0, 3, IIF( codepoint >= 0xE0, 2, IIF( codepoint >= 0xC0, 1, 0 ) ) );
+         codepoint &= 0xFF >> ( extra + IIF( extra, 2, 1 ) );
+         for( ; extra > 0 && p < end; extra-- )
+         {
+            codepoint = ( codepoint << 6 ) | ( *p++ & 0x3F );
+         }
+
+         if( !sequence )
+         {
+            gt_builderMap( builder, codepoint, i );
+         }
+      }
+      p++;
+   }
+   return T;
+}
+
+/* ------------------------------------------------------------------------- */
+static void gt_fontCachePath( const char *path, const struct stat *source, char *cachePath, size_t size )
+{
+   Uint32 hash = 2166136261u; // FNV-1a
+
+   for( const char *p = path; *p; p++ )
+   {
+      hash = ( hash ^ ( unsigned char ) *p ) * 16777619u;
+   }
+
+   snprintf( cachePath, size, "%s%sfont-%08x-%llx.gtf", gt_cacheDir(), gt_pathSeparator(), hash, ( unsigned long long ) source->st_size );
+}
+
+static void *gt_readFile( const char *path, size_t *size )
+{
+   FILE *file = fopen( path, "rb" );
+   if( !file )
+   {
+      perror( path );
+      return NULL;
+   }
+
+   fseek( file, 0, SEEK_END );
+   long length = ftell( file );
+   fseek( file, 0, SEEK_SET );
+
+   char *data = IIF( length > 0, malloc( length + 1 ), NULL );
+   if( !data || fread( data, 1, length, file ) != ( size_t ) length )
+   {
+      fprintf( stderr, "Font file cannot be read: %s\n", path );
+      free( data );
+      fclose( file );
+      return NULL;
+   }
+   data[ length ] = '\0';
+   fclose( file );
+
+   *size = length;
+   return data;
+}
+
+// Writes the image under a temporary name first, so other processes never map a partial file; F leaves any old cache in place
+static bool gt_writeFontCache( const char *cachePath, const void *data, size_t size )
+{
+   char tempPath[ PATH_MAX + 32 ];
+   snprintf( tempPath, sizeof( tempPath ), "%s.%llx", cachePath, ( unsigned long long ) SDL_GetPerformanceCounter() );
+
+   FILE *file = fopen( tempPath, "wb" );
+   if( !file )
+   {
+      return F;
+   }
+
+   bool ok = fwrite( data, 1, size, file ) == size;
+   ok = fclose( file ) == 0 && ok;
+
+   if( ok && rename( tempPath, cachePath ) != 0 )
+   {
+      // Windows does not replace an existing file
+      remove( cachePath );
+      ok = rename( tempPath, cachePath ) == 0;
+   }
+   if( !ok )
+   {
+      remove( tempPath );
+   }
+   return ok;
+}
+
+GTFont *gt_loadFont( const char *path )
+{
+   struct stat source;
+   char cachePath[ PATH_MAX ];
+   size_t size;
+
+   if( stat( path, &source ) != 0 )
+   {
+      perror( path );
+      return NULL;
+   }
+
+   GTFont *font = calloc( 1, sizeof( GTFont ) );
+   if( !font )
+   {
+      fprintf( stderr, "Memory allocation failed for font.\n" );
+      return NULL;
+   }
+
+   gt_fontCachePath( path, &source, cachePath, sizeof( cachePath ) );
+
+   void *data = gt_mapFile( cachePath, &size );
+   if( data )
+   {
+      if( gt_fontAttach( font, data, size ) && gt_fontCurrent( data, &source ) )
+      {
+         font->mapped = T;
+         return font;
+      }
+      gt_unmapFile( data, size );
+   }
+
+   // No valid cache yet, parse the font and write one
+   char *text = gt_readFile( path, &size );
+   GTFontBuilder *builder = calloc( 1, sizeof( GTFontBuilder ) );
+   if( !text || !builder )
+   {
+      free( text );
+      free( builder );
+      free( font );
+      return NULL;
+   }
+   builder->defaultChar = -1;
+
+   bool parsed;
+   if( size >= 4 && gt_le32( ( const Uint8 * ) text ) == PSF2_MAGIC )
+   {
+      parsed = gt_parsePSF2( builder, ( const Uint8 * ) text, size );
+   }
+   else if( strncmp( text, "STARTFONT", 9 ) == 0 )
+   {
+      parsed = gt_parseBDF( builder, text, size );
+   }
+   else
+   {
+      fprintf( stderr, "Unknown font format: %s\n", path );
+      parsed = F;
+   }
+   free( text );
+
+   size_t layoutSize;
+   data = IIF( parsed, gt_builderLayout( builder, &layoutSize, &source ), NULL );
+   free( builder->glyphs );
+   free( builder );
+   if( !data )
+   {
+      free( font );
+      return NULL;
+   }
+
+   // Mapped only when it was written now, a failed write leaves the stale cache of an edited font behind
+   if( gt_writeFontCache( cachePath, data, layoutSize ) )
+   {
+      void *mapped = gt_mapFile( cachePath, &size );
+      if( mapped )
+      {
+         if( gt_fontAttach( font, mapped, size ) && gt_fontCurrent( mapped, &source ) )
+         {
+            free( data );
+            font->mapped = T;
+            return font;
+         }
+         gt_unmapFile( mapped, size );
+      }
+   }
+
+   // The cache directory is not writable, keep a private copy
+   if( !gt_fontAttach( font, data, layoutSize ) )
+   {
+      fprintf( stderr, "Font cannot be laid out: %s\n", path );
+      free( data );
+      free( font );
+      return NULL;
+   }
+   return font;
+}
+
+void gt_freeFont( GTFont *font )
+{
+   if( !font || font == &gtFontBuiltin )
+   {
+      return;
+   }
+
+   if( font->mapped )
+   {
+      gt_unmapFile( font->data, font->size );
+   }
+   else
+   {
+      free( font->data );
+   }
+   free( font );
+}
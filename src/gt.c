@@ -2,289 +2,1383 @@
  *
  */
 
-#include "gt.h"
+#include "gt_private.h"
 
 /* ------------------------------------------------------------------------- */
 // static
-static void gt_clearColor( const char *hex )
+static int gt_hexDigit( char ch )
 {
-   int r, g, b, a = 255;
+   if( ch >= '0' && ch <= '9' ) return ch - '0';
+   if( ch >= 'a' && ch <= 'f' ) return ch - 'a' + 10;
+   if( ch >= 'A' && ch <= 'F' ) return ch - 'A' + 10;
+   return -1;
+}
+
+// Parses "RRGGBB" or "RRGGBBAA" of the given length
+static bool gt_parseHex( const char *hex, size_t len, gt_color *color )
+{
+   Uint32 value = 0;
+
+   if( len != 6 && len != 8 )
+   {
+      return F;
+   }
+
+   for( size_t i = 0; i < len; i++ )
+   {
+      int digit = gt_hexDigit( hex[ i ] );
+      if( digit < 0 )
+      {
+         return F;
+      }
+      value = ( value << 4 ) | digit;
+   }
+
+   *color = IIF( len == 6, ( value << 8 ) | 0xFF, value );
+   return T;
+}
+
+/* ------------------------------------------------------------------------- */
+// color cache, every distinct "RRGGBB/RRGGBB" string is parsed once per process
+#define COLOR_CACHE_SIZE 256 // power of two
+#define COLOR_KEY_SIZE   20
+
+typedef struct
+{
+   char         key[ COLOR_KEY_SIZE ];
+   gt_colorPair pair;
+} GTColorEntry;
+
+static GTColorEntry gtColorCache[ COLOR_CACHE_SIZE ];
+static int          gtColorCacheCount = 0;
+
+static gt_colorPair gt_parseColorPair( const char *colorString, size_t len )
+{
+   gt_colorPair pair = { GT_RGB( 255, 255, 255 ), GT_RGB( 0, 0, 0 ) };
+   gt_color bg, fg;
+
+   if( len == 13 && colorString[ 6 ] == '/' &&
+       gt_parseHex( colorString, 6, &bg ) && gt_parseHex( colorString + 7, 6, &fg ) )
+   {
+      pair.bg = bg;
+      pair.fg = fg;
+   }
+
+   return pair;
+}
+
+static gt_colorPair gt_colorCacheLookup( const char *colorString )
+{
+   Uint32 hash = 2166136261u; // FNV-1a
+   size_t len = 0;
+
+   for( const char *p = colorString; *p; p++, len++ )
+   {
+      hash = ( hash ^ ( unsigned char ) *p ) * 16777619u;
+   }
+
+   if( len >= COLOR_KEY_SIZE )
+   {
+      return gt_parseColorPair( colorString, len );
+   }
+
+   for( Uint32 i = hash & ( COLOR_CACHE_SIZE - 1 ); ; i = ( i + 1 ) & ( COLOR_CACHE_SIZE - 1 ) )
+   {
+      GTColorEntry *entry = &gtColorCache[ i ];
+
+      if( entry->key[ 0 ] == '\0' )
+      {
+         gt_colorPair pair = gt_parseColorPair( colorString, len );
+
+         // Keep a quarter of the table free so probing stays short
+         if( len > 0 && gtColorCacheCount < COLOR_CACHE_SIZE * 3 / 4 )
+         {
+            memcpy( entry->key, colorString, len + 1 );
+            entry->pair = pair;
+            gtColorCacheCount++;
+         }
+         return pair;
+      }
+
+      if( strcmp( entry->key, colorString ) == 0 )
+      {
+         return entry->pair;
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------- */
+// damage, the cells that changed since the frame on screen, as up to GT_MAX_DAMAGE rectangles in cell units
+static void gt_addDamageRect( GT *gt, const SDL_Rect *rect )
+{
+   if( gt->damageCount == GT_MAX_DAMAGE )
+   {
+      // Too scattered to be worth tracking separately, fall back to the bounding box
+      for( int d = 1; d < gt->damageCount; d++ )
+      {
+         SDL_UnionRect( &gt->damage[ 0 ], &gt->damage[ d ], &gt->damage[ 0 ] );
+      }
+      SDL_UnionRect( &gt->damage[ 0 ], rect, &gt->damage[ 0 ] );
+      gt->damageCount = 1;
+      return;
+   }
+
+   gt->damage[ gt->damageCount++ ] = *rect;
+}
+
+static void gt_addDamage( GT *gt, int col, int row, int width )
+{
+   SDL_Rect line = { col, row, width, 1 };
+
+   if( gt->damageCount > 0 )
+   {
+      SDL_Rect *last = &gt->damage[ gt->damageCount - 1 ];
+
+      // The same span on consecutive rows grows the previous rectangle, e.g. a moved selection bar
+      if( last->x == col && last->w == width && last->y + last->h == row )
+      {
+         last->h++;
+         return;
+      }
+   }
+
+   gt_addDamageRect( gt, &line );
+}
+
+void gt_collectDamage( GT *gt )
+{
+   gt->damageCount = 0;
+
+   if( gt->fullRedraw )
+   {
+      SDL_Rect all = { 0, 0, gt->cellCols, gt->cellRows };
+      gt->damage[ 0 ] = all;
+      gt->damageCount = 1;
+      gt->frameCounts.cellsChanged = gt->cellCols * gt->cellRows;
+      return;
+   }
+
+   for( int row = 0; row < gt->cellRows; row++ )
+   {
+      const GTCell *cells     = gt->cells + row * gt->cellCols;
+      const GTCell *prevCells = gt->prevCells + row * gt->cellCols;
+      int first = -1;
+      int last  = -1;
+
+      for( int col = 0; col < gt->cellCols; col++ )
+      {
+         if( memcmp( &cells[ col ], &prevCells[ col ], sizeof( GTCell ) ) != 0 )
+         {
+            if( first < 0 )
+            {
+               first = col;
+            }
+            last = col;
+            gt->frameCounts.cellsChanged++;
+         }
+      }
+
+      if( first >= 0 )
+      {
+         gt_addDamage( gt, first, row, last - first + 1 );
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------- */
+// cell grid
+static GT *gtCurrent = NULL; // window between gt_beginDraw() and gt_endDraw()
+
+void gt_resizeGrid( GT *gt, int cols, int rows )
+{
+   GTCell *cells     = malloc( sizeof( GTCell ) * cols * rows );
+   GTCell *prevCells = malloc( sizeof( GTCell ) * cols * rows );
+   if( !cells || !prevCells )
+   {
+      fprintf( stderr, "Memory allocation failed for cell grid.\n" );
+      free( cells );
+      free( prevCells );
+      return;
+   }
+
+   free( gt->cells );
+   free( gt->prevCells );
+   gt->cells     = cells;
+   gt->prevCells = prevCells;
+   gt->cellCols  = cols;
+   gt->cellRows  = rows;
+
+   // A render thread owns the backend, it resizes it once a frame of the new size arrives
+   if( !gt->renderThread )
+   {
+      gt->backend->resize( gt );
+   }
+   gt->fullRedraw = T;
+}
+
+// Clips a cell rectangle to cols x rows, returns F when nothing of it is left
+static bool gt_clipRect( int cols, int rows, int *x, int *y, int *width, int *height )
+{
+   if( *x < 0 )
+   {
+      *width += *x;
+      *x = 0;
+   }
+   if( *y < 0 )
+   {
+      *height += *y;
+      *y = 0;
+   }
+   *width  = MIN( *width, cols - *x );
+   *height = MIN( *height, rows - *y );
+
+   return *width > 0 && *height > 0;
+}
+
+static void gt_freeLayer( GTLayer *layer )
+{
+   GT *gt = layer->gt;
+
+   if( gt->target == layer )
+   {
+      gt->target = NULL;
+   }
+   free( layer->cells );
+   free( layer->under );
+   free( layer );
+}
+
+// Puts back what the layers covered in the last frame, top first, so overlapping layers unwind in order.
+// covered stays set until the next gt_compositeLayers(), the frame on screen still shows the layers there.
+static void gt_uncoverLayers( GT *gt )
+{
+   for( int l = gt->layerCount - 1; l >= 0; l-- )
+   {
+      GTLayer *layer = gt->layers[ l ];
+      const SDL_Rect *rect = &layer->covered;
+
+      for( int row = 0; row < rect->h; row++ )
+      {
+         memcpy( gt->cells + ( rect->y + row ) * gt->cellCols + rect->x, layer->under + row * rect->w, sizeof( GTCell ) * rect->w );
+      }
+   }
+}
+
+// Whether a layer shows in the area of the frame on screen, closed ones until the next frame took them away
+static bool gt_layersCover( GT *gt, const SDL_Rect *area )
+{
+   for( int l = 0; l < gt->layerCount; l++ )
+   {
+      if( SDL_HasIntersection( &gt->layers[ l ]->covered, area ) )
+      {
+         return T;
+      }
+   }
+   return F;
+}
+
+// Merges the visible layers into the grid bottom to top, saving the cells under each; closed layers are freed here
+static void gt_compositeLayers( GT *gt )
+{
+   int count = 0;
+
+   for( int l = 0; l < gt->layerCount; l++ )
+   {
+      GTLayer *layer = gt->layers[ l ];
+
+      if( layer->closed )
+      {
+         gt_freeLayer( layer );
+         continue;
+      }
+      gt->layers[ count++ ] = layer;
+
+      int x = layer->x;
+      int y = layer->y;
+      int width = layer->width;
+      int height = layer->height;
+
+      layer->covered.w = 0;
+      if( !layer->visible || !gt_clipRect( gt->cellCols, gt->cellRows, &x, &y, &width, &height ) )
+      {
+         continue;
+      }
+
+      for( int row = 0; row < height; row++ )
+      {
+         GTCell *line = gt->cells + ( y + row ) * gt->cellCols + x;
+         const GTCell *source = layer->cells + ( y - layer->y + row ) * layer->width + ( x - layer->x );
+
+         memcpy( layer->under + row * width, line, sizeof( GTCell ) * width );
+         for( int col = 0; col < width; col++ )
+         {
+            if( source[ col ].codepoint != 0 )
+            {
+               line[ col ] = source[ col ];
+            }
+         }
+      }
+      layer->covered = ( SDL_Rect ){ x, y, width, height };
+   }
+   gt->layerCount = count;
+}
+
+static void gt_swapCells( GT *gt )
+{
+   GTCell *swap   = gt->prevCells;
+   gt->prevCells  = gt->cells;
+   gt->cells      = swap;
+   gt->fullRedraw = F;
+}
+
+// Renders what differs between gt->cells and gt->prevCells, then gt->cells is the frame on screen
+void gt_presentFrame( GT *gt )
+{
+   // An unchanged grid is neither rendered nor swapped, the frame on screen stays
+   gt_collectDamage( gt );
+   if( gt->scrolled.w > 0 && !gt->fullRedraw )
+   {
+      // Moved pixels have to reach the screen even where the cells did not change
+      gt_addDamageRect( gt, &gt->scrolled );
+   }
+   gt->scrolled.w = 0;
+
+   for( int d = 0; d < gt->damageCount; d++ )
+   {
+      gt->frameCounts.cellsSubmitted += gt->damage[ d ].w * gt->damage[ d ].h;
+   }
+
+   if( gt->damageCount > 0 )
+   {
+      gt_traceBegin( "submit", gt->backend->name );
+      gt->backend->submit( gt );
+      gt_traceEnd();
+      gt_traceBegin( "present", gt->backend->name );
+      gt->backend->present( gt );
+      gt_traceEnd();
+   }
+
+   gt_swapCells( gt );
+}
+
+/* ------------------------------------------------------------------------- */
+// open windows; SDL, the GL context group, the glyph caches and the color cache stay up while any of them is open
+static GT *gtWindows[ GT_MAX_WINDOWS ];
+static int gtWindowCount = 0;
+
+static void gt_addWindow( GT *gt )
+{
+   gtWindows[ gtWindowCount++ ] = gt;
+}
+
+static void gt_removeWindow( GT *gt )
+{
+   for( int w = 0; w < gtWindowCount; w++ )
+   {
+      if( gtWindows[ w ] == gt )
+      {
+         gtWindows[ w ] = gtWindows[ --gtWindowCount ];
+         break;
+      }
+   }
+}
+
+// Another open window rendered by the given backend, NULL for none
+GT *gt_otherWindow( const GT *gt, const GTBackend *backend )
+{
+   for( int w = 0; w < gtWindowCount; w++ )
+   {
+      if( gtWindows[ w ] != gt && gtWindows[ w ]->backend == backend )
+      {
+         return gtWindows[ w ];
+      }
+   }
+   return NULL;
+}
+
+int gt_windowCount( void )
+{
+   return gtWindowCount;
+}
+
+// Window events that invalidate the frame on screen schedule a new one
+static int gt_windowWatch( void *userdata, SDL_Event *event )
+{
+   GT *gt = userdata;
+
+   if( event->type == SDL_WINDOWEVENT && gt->window && event->window.windowID == SDL_GetWindowID( gt->window ) )
+   {
+      switch( event->window.event )
+      {
+         case SDL_WINDOWEVENT_EXPOSED:
+            // Whatever covered the window may have destroyed its contents
+            gt->fullRedraw = T;
+            gt->redrawRequested = T;
+            break;
+
+         case SDL_WINDOWEVENT_SIZE_CHANGED:
+         case SDL_WINDOWEVENT_RESTORED:
+            gt->redrawRequested = T;
+            break;
+
+#if SDL_VERSION_ATLEAST( 2, 0, 18 )
+         case SDL_WINDOWEVENT_DISPLAY_CHANGED:
+            // The new display may have another DPI, gt_beginDraw() detects the scale again
+            gt->fullRedraw = T;
+            gt->redrawRequested = T;
+            break;
+#endif
+
+         default:
+            break;
+      }
+   }
+   else if( event->type == SDL_MOUSEWHEEL && event->wheel.y != 0 && gt->window && event->wheel.windowID == SDL_GetWindowID( gt->window ) &&
+            ( SDL_GetModState() & KMOD_CTRL ) )
+   {
+      // Ctrl+wheel zooms in whole steps
+      gt_setScale( gt, gt->scale + IIF( event->wheel.y > 0, 1, -1 ) );
+   }
+   return 0;
+}
+
+// Creates the window of a backend at the size the program asked for, which also becomes its minimum size
+bool gt_openWindow( GT *gt, const char *title, Uint32 flags )
+{
+   if( SDL_Init( SDL_INIT_VIDEO ) != 0 )
+   {
+      fprintf( stderr, "Unable to initialize SDL: %s\n", SDL_GetError() );
+      return F;
+   }
+
+   gt->window = SDL_CreateWindow( title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, gt->width, gt->height,
+                                  flags | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE );
+   if( !gt->window )
+   {
+      fprintf( stderr, "Could not create window: %s\n", SDL_GetError() );
+      return F;
+   }
+
+   SDL_AddEventWatch( gt_windowWatch, gt );
+   SDL_SetWindowMinimumSize( gt->window, gt->width, gt->height );
+   return T;
+}
+
+void gt_closeWindow( GT *gt )
+{
+   if( gt->window )
+   {
+      SDL_DelEventWatch( gt_windowWatch, gt );
+      SDL_DestroyWindow( gt->window );
+      gt->window = NULL;
+   }
+}
+
+// GT_RENDERER=legacy|core|software|headless|terminal overrides what the program asked for, GT_HEADLESS=1 overrides both
+static const GTBackend *gt_selectBackend( GTRenderer renderer )
+{
+   static const GTBackend *backends[] = { &gtBackendGLLegacy, &gtBackendGLCore, &gtBackendSoftware, &gtBackendHeadless, &gtBackendTerminal };
+   const GTBackend *backend = &gtBackendGLLegacy;
+
+   for( size_t i = 0; i < LEN( backends ); i++ )
+   {
+      if( backends[ i ]->renderer == renderer )
+      {
+         backend = backends[ i ];
+      }
+   }
+
+   const char *name = getenv( "GT_RENDERER" );
+   if( name && *name )
+   {
+      size_t i;
+      for( i = 0; i < LEN( backends ) && strcmp( backends[ i ]->name, name ) != 0; i++ )
+         ;
+      if( i < LEN( backends ) )
+      {
+         backend = backends[ i ];
+      }
+      else
+      {
+         fprintf( stderr, "Unknown GT_RENDERER '%s', using the %s renderer.\n", name, backend->name );
+      }
+   }
+
+   // GT_HEADLESS=1 lets CI run any GT program without a display
+   const char *headless = getenv( "GT_HEADLESS" );
+   if( headless && *headless && strcmp( headless, "0" ) != 0 )
+   {
+      backend = &gtBackendHeadless;
+   }
+
+   return backend;
+}
+
+// GT_SCALE=n forces a scale; otherwise HiDPI drawables keep their pixel ratio and other displays are scaled by DPI
+static int gt_detectScale( GT *gt )
+{
+   const char *env = getenv( "GT_SCALE" );
+   int scale = 1;
+   float dpi;
+
+   if( env && atoi( env ) > 0 )
+   {
+      scale = atoi( env );
+   }
+   else if( gt->pixelRatio > 1 )
+   {
+      scale = gt->pixelRatio;
+   }
+   else if( gt->window && SDL_GetDisplayDPI( SDL_GetWindowDisplayIndex( gt->window ), &dpi, NULL, NULL ) == 0 )
+   {
+      scale = ( int )( dpi / 96.0f + 0.5f );
+   }
+
+   return MAX( 1, MIN( scale, GT_MAX_SCALE ) );
+}
+
+/* ------------------------------------------------------------------------- */
+// internal
+// Reports every error flag that is set, GL keeps one per kind until glGetError() clears it
+void check_open_gl_error( const char *stmt, const char *fname, int line, GLenum *errCode )
+{
+   GLenum err;
+
+   *errCode = GL_NO_ERROR;
+   for( int flags = 0; flags < 8 && ( err = glGetError() ) != GL_NO_ERROR; flags++ )
+   {
+      printf( "OpenGL error %08x, at %s:%i - for %s\n", err, fname, line, stmt );
+      if( *errCode == GL_NO_ERROR )
+      {
+         *errCode = err;
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------- */
+// API functions
+GT *gt_createWindow( int width, int height, const char *title, const char *hexColor )
+{
+   return gt_createWindowEx( width, height, title, hexColor, GT_RENDERER_DEFAULT );
+}
+
+GT *gt_createWindowEx( int width, int height, const char *title, const char *hexColor, GTRenderer renderer )
+{
+   setlocale( LC_ALL, "en_US.UTF-8" );
+
+   if( gtWindowCount == GT_MAX_WINDOWS )
+   {
+      fprintf( stderr, "Unable to open more than %d windows.\n", GT_MAX_WINDOWS );
+      return NULL;
+   }
+
+   // The caches windows share are not locked, so they are only ever used from one thread
+   for( int w = 0; w < gtWindowCount; w++ )
+   {
+      if( gtWindows[ w ]->renderThread )
+      {
+         fprintf( stderr, "Another window is opening, rendering on the calling thread again.\n" );
+         gt_stopRenderThread( gtWindows[ w ] );
+      }
+   }
+
+   GT *gt = malloc( sizeof( GT ) );
+   if( !gt )
+   {
+      fprintf( stderr, "Memory allocation failed for GT structure.\n" );
+      return NULL;
+   }
+
+   memset( gt, 0, sizeof( GT ) );
+   gt->redrawRequested = T;
+   gt->width = width;
+   gt->height = height;
+   gt->background = hexColor;
+   gt->backgroundColor = gt_hexColor( hexColor );
+   gt->backend = gt_selectBackend( renderer );
+
+   // GT_FONT=/path/font.bdf replaces the built-in font without rebuilding the program
+   const char *fontPath = getenv( "GT_FONT" );
+   if( fontPath && *fontPath )
+   {
+      gt->ownedFont = gt_loadFont( fontPath );
+   }
+   gt_setFont( gt, gt->ownedFont );
+
+   gt->scale      = 1;
+   gt->autoScale  = T;
+   gt->pixelRatio = 1;
+   gt->cellWidth  = gt->font->width;
+   gt->cellHeight = gt->font->height;
+
+   // A backend that cannot start on this host hands over to a simpler one
+   while( !gt->backend->init( gt, title ) )
+   {
+      if( !gt->backend->fallback )
+      {
+         if( gtWindowCount == 0 )
+         {
+            SDL_Quit();
+         }
+         gt_freeFont( gt->ownedFont );
+         free( gt );
+         return NULL;
+      }
+      fprintf( stderr, "The %s renderer is unavailable, falling back to the %s renderer.\n", gt->backend->name, gt->backend->fallback->name );
+      gt->backend = gt->backend->fallback;
+   }
+   gt->renderer = gt->backend->renderer;
+   gt_addWindow( gt );
+
+   // GT_RENDER_THREAD=1 presents frames on a thread of their own, see gt_startRenderThread()
+   const char *renderThread = getenv( "GT_RENDER_THREAD" );
+   if( renderThread && *renderThread && strcmp( renderThread, "0" ) != 0 )
+   {
+      gt_startRenderThread( gt );
+   }
+
+   // GT_STATS=/path/file or GT_STATS=unix:/path/socket exports the frame statistics of the first window
+   const char *statsTarget = getenv( "GT_STATS" );
+   if( statsTarget && *statsTarget && gtWindowCount == 1 )
+   {
+      gt_exportStats( gt, statsTarget );
+   }
+
+   // GT_TRACE=/path.json records a timeline until the last window closes, see gt_traceStart()
+   const char *tracePath = getenv( "GT_TRACE" );
+   if( tracePath && *tracePath && gtWindowCount == 1 )
+   {
+      gt_traceStart( tracePath );
+   }
+
+   return gt;
+}
+
+void gt_clearAll( GT *gt )
+{
+   if( gtCurrent == gt )
+   {
+      gtCurrent = NULL;
+   }
+
+   gt_stopRenderThread( gt );
+   gt_freeStats( gt );
+   gt->backend->destroy( gt );
+   free( gt->cells );
+   free( gt->prevCells );
+   gt_freeFont( gt->ownedFont );
+
+   for( int l = 0; l < gt->layerCount; l++ )
+   {
+      gt_freeLayer( gt->layers[ l ] );
+   }
+
+   // SDL_Quit() would close every other window as well
+   gt_removeWindow( gt );
+   if( gtWindowCount == 0 )
+   {
+      gt_traceStop();
+      SDL_Quit();
+   }
+
+   free( gt );
+   gt = NULL;
+}
+
+void gt_beginDraw( GT *gt )
+{
+   int newWidth, newHeight;
+   int newWidthPos, newHeightPos;
+   int newMouseX, newMouseY;
+
+   GT_PROBE1( frame_begin, gt );
+   gt_statsBegin( gt );
+   gt_traceBegin( "gt_beginDraw", NULL );
+   gt->backend->beginFrame( gt, &newWidth, &newHeight );
+
+   if( gt->autoScale && ( !gt->cells || gt->fullRedraw || newWidth != gt->width || newHeight != gt->height ) )
+   {
+      gt->scale = gt_detectScale( gt );
+   }
+
+   // Font and scale changes take effect here, never in the middle of a frame
+   int cellWidth  = gt->font->width * gt->scale;
+   int cellHeight = gt->font->height * gt->scale;
+
+   if( !gt->cells || newWidth != gt->width || newHeight != gt->height || cellWidth != gt->cellWidth || cellHeight != gt->cellHeight )
+   {
+      gt->width = newWidth;
+      gt->height = newHeight;
+      gt->cellWidth = cellWidth;
+      gt->cellHeight = cellHeight;
+      gt_resizeGrid( gt, ( newWidth + cellWidth - 1 ) / cellWidth, ( newHeight + cellHeight - 1 ) / cellHeight );
+   }
+
+   if( gt->window )
+   {
+      SDL_GetWindowPosition( gt->window, &newWidthPos, &newHeightPos ); // ?!
+      gt->widthPos = newWidthPos;
+      gt->heightPos = newHeightPos;
+
+      SDL_GetMouseState( &newMouseX, &newMouseY );
+      gt->mouseX = newMouseX;
+      gt->mouseY = newMouseY;
+   }
+
+   // Start every frame from an empty grid, the previous one is kept for diffing
+   if( gt->cells )
+   {
+      GTCell blank = { ' ', gt->backgroundColor, gt->backgroundColor };
+
+      for( int i = 0; i < gt->cellCols * gt->cellRows; i++ )
+      {
+         gt->cells[ i ] = blank;
+      }
+   }
+
+   gtCurrent = gt;
+   gt_traceEnd();
+
+   // Everything drawn until gt_endDraw(), gt_drawText() and the other calls of the frame
+   gt_traceBegin( "draw calls", NULL );
+}
+
+void gt_endDraw( GT *gt )
+{
+   gt_traceEnd();
+   gt_traceBegin( "gt_endDraw", NULL );
+   gt->target = NULL;
+
+   if( gt->cells )
+   {
+      gt_compositeLayers( gt );
+
+      if( gt->renderThread )
+      {
+         // The render thread diffs the frame against what it presented itself
+         gt_publishFrame( gt );
+         gt_swapCells( gt );
+      }
+      else
+      {
+         gt_presentFrame( gt );
+      }
+   }
+
+   gt->redrawRequested = F;
+   gt->lastFrame = SDL_GetPerformanceCounter();
+   GT_PROBE3( frame_end, gt, gt->frameCounts.cellsChanged, gt->frameCounts.cellsSubmitted );
+   gt_statsEnd( gt );
+
+   gtCurrent = NULL;
+   gt_traceEnd();
+}
+
+// Copies a rectangle of the last presented frame as 0xRRGGBBAA, top row first
+bool gt_readPixels( GT *gt, int x, int y, int width, int height, gt_color *pixels )
+{
+   if( !pixels || x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > gt->width || y + height > gt->height )
+   {
+      fprintf( stderr, "gt_readPixels: rectangle %d,%d %dx%d outside the %dx%d frame.\n", x, y, width, height, gt->width, gt->height );
+      return F;
+   }
+   if( gt->renderThread )
+   {
+      fprintf( stderr, "gt_readPixels: the frame belongs to the render thread, stop it first.\n" );
+      return F;
+   }
+
+   return gt->backend->readPixels( gt, x, y, width, height, pixels );
+}
+
+// Writes the last presented frame as a binary PPM, the format golden images are kept in
+bool gt_saveFramePPM( GT *gt, const char *path )
+{
+   gt_color *pixels = malloc( sizeof( gt_color ) * gt->width * gt->height );
+   if( !pixels )
+   {
+      fprintf( stderr, "Memory allocation failed for frame.\n" );
+      return F;
+   }
+
+   if( !gt_readPixels( gt, 0, 0, gt->width, gt->height, pixels ) )
+   {
+      free( pixels );
+      return F;
+   }
+
+   FILE *file = fopen( path, "wb" );
+   if( !file )
+   {
+      perror( path );
+      free( pixels );
+      return F;
+   }
+
+   fprintf( file, "P6\n%d %d\n255\n", gt->width, gt->height );
+   for( int i = 0; i < gt->width * gt->height; i++ )
+   {
+      Uint8 rgb[ 3 ] = { GT_R( pixels[ i ] ), GT_G( pixels[ i ] ), GT_B( pixels[ i ] ) };
+      fwrite( rgb, 1, sizeof( rgb ), file );
+   }
+
+   bool ok = !ferror( file );
+   fclose( file );
+   free( pixels );
+
+   return ok;
+}
+
+/* ------------------------------------------------------------------------- */
+// frame scheduler, programs draw only when gt_frameDue() says so instead of after every event
+void gt_requestRedraw( GT *gt )
+{
+   gt->redrawRequested = T;
+}
+
+void gt_setMaxFps( GT *gt, int fps )
+{
+   gt->maxFps = MAX( fps, 0 );
+}
+
+bool gt_setSync( GT *gt, GTSync sync )
+{
+   if( gt->renderThread )
+   {
+      gt_requestSync( gt, sync );
+      return T;
+   }
+
+   if( !gt->glContext )
+   {
+      // Window surfaces are copied as soon as they are updated
+      return sync == GT_SYNC_IMMEDIATE;
+   }
+   gt_glMakeCurrent( gt );
+
+   if( sync == GT_SYNC_ADAPTIVE )
+   {
+      if( SDL_GL_SetSwapInterval( -1 ) == 0 )
+      {
+         return T;
+      }
+      fprintf( stderr, "Adaptive sync unavailable, using vsync: %s\n", SDL_GetError() );
+      sync = GT_SYNC_VSYNC;
+   }
+
+   if( SDL_GL_SetSwapInterval( sync == GT_SYNC_VSYNC ? 1 : 0 ) != 0 )
+   {
+      fprintf( stderr, "SDL_GL_SetSwapInterval failed: %s\n", SDL_GetError() );
+      return F;
+   }
+   return T;
+}
+
+// Milliseconds until the frame cap allows the next frame, 0 when it may be drawn now
+static Uint32 gt_frameDelay( GT *gt )
+{
+   if( gt->maxFps == 0 || gt->lastFrame == 0 )
+   {
+      return 0;
+   }
+
+   Uint64 frequency = SDL_GetPerformanceFrequency();
+   Uint64 interval  = frequency / gt->maxFps;
+   Uint64 elapsed   = SDL_GetPerformanceCounter() - gt->lastFrame;
+
+   if( elapsed >= interval )
+   {
+      return 0;
+   }
+   return ( Uint32 )( ( ( interval - elapsed ) * 1000 + frequency - 1 ) / frequency );
+}
+
+bool gt_frameDue( GT *gt )
+{
+   if( gt->backend == &gtBackendTerminal && gt_termResized( gt ) )
+   {
+      // The terminal may have reflowed or cleared what it showed
+      gt->fullRedraw = T;
+   }
+   return ( gt->redrawRequested || gt->fullRedraw ) && gt_frameDelay( gt ) == 0;
+}
+
+// Waits for the next event, but no longer than until a requested frame is due
+bool gt_waitEvent( GT *gt, SDL_Event *event )
+{
+   if( !gt->redrawRequested && !gt->fullRedraw )
+   {
+      return SDL_WaitEvent( event ) != 0;
+   }
+
+   Uint32 delay = gt_frameDelay( gt );
+   if( delay == 0 )
+   {
+      return SDL_PollEvent( event ) != 0;
+   }
+   return SDL_WaitEventTimeout( event, delay ) != 0;
+}
+
+/* ------------------------------------------------------------------------- */
+// Switches the font of a window from the next frame on, NULL selects the built-in one
+void gt_setFont( GT *gt, const GTFont *font )
+{
+   if( gtCurrent == gt )
+   {
+      fprintf( stderr, "gt_setFont: cannot change the font between gt_beginDraw() and gt_endDraw().\n" );
+      return;
+   }
+
+   font = IIF( font, font, &gtFontBuiltin );
+   if( font != gt->font )
+   {
+      // Cells that did not change still show glyphs of the old font, and the GL atlas is rebuilt for the new one
+      gt->font = font;
+      gt->fullRedraw = T;
+      gt->redrawRequested = T;
+   }
+}
+
+// Magnifies the font by a whole factor from the next frame on, 0 goes back to following the display
+void gt_setScale( GT *gt, int scale )
+{
+   if( scale == 0 )
+   {
+      gt->autoScale = T;
+      gt->fullRedraw = T;
+   }
+   else
+   {
+      gt->autoScale = F;
+      gt->scale = MAX( 1, MIN( scale, GT_MAX_SCALE ) );
+   }
+   gt->redrawRequested = T;
+}
+
+int gt_scale( GT *gt )
+{
+   return gt->scale;
+}
+
+/* ------------------------------------------------------------------------- */
+SDL_Color gt_hexToColor( const char *hexColor )
+{
+   SDL_Color color = { 128, 128, 128, 255 };
+   gt_color value;
+
+   if( gt_parseHex( hexColor, strlen( hexColor ), &value ) )
+   {
+      color.r = GT_R( value );
+      color.g = GT_G( value );
+      color.b = GT_B( value );
+      color.a = GT_A( value );
+   }
+   else
+   {
+      fprintf( stderr, "Invalid hex color format: gt_hexToColor() - defaulting to gray.\n" );
+   }
+
+   return color;
+}
+
+gt_color gt_hexColor( const char *hexColor )
+{
+   gt_color color;
+
+   if( !gt_parseHex( hexColor, strlen( hexColor ), &color ) )
+   {
+      fprintf( stderr, "Invalid hex color format: gt_hexColor() - defaulting to gray.\n" );
+      color = GT_RGB( 128, 128, 128 );
+   }
+
+   return color;
+}
+
+gt_colorPair gt_hexColorPair( const char *hexColor )
+{
+   if( hexColor == NULL )
+   {
+      return gt_parseColorPair( "", 0 );
+   }
+
+   return gt_colorCacheLookup( hexColor );
+}
+
+/* ------------------------------------------------------------------------- */
+// Decodes one UTF-8 sequence and returns its length in bytes; a sequence cut short by the terminator becomes U+FFFD
+static int gt_utf8Decode( const char *string, unsigned int *codepoint )
+{
+   unsigned char ch = ( unsigned char ) string[ 0 ];
+   int bytes;
 
-   if( strlen( hex ) == 6 ) // Format: RRGGBB
+   if( ch <= 0x7F )
    {
-      sscanf( hex, "%02x%02x%02x", &r, &g, &b );
-      glClearColor( r / 255.0f, g / 255.0f, b / 255.0f, 1.0f );
+      *codepoint = ch;
+      return 1;
    }
-   else if( strlen( hex ) == 8 ) // Format: RRGGBBAA
+   else if( ch <= 0xDF )
    {
-      sscanf( hex, "%02x%02x%02x%02x", &r, &g, &b, &a );
-      glClearColor( r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f );
+      *codepoint = ch & 0x1F;
+      bytes = 2;
+   }
+   else if( ch <= 0xEF )
+   {
+      *codepoint = ch & 0x0F;
+      bytes = 3;
    }
    else
    {
-      fprintf( stderr, "Invalid hex color format: gt_clearColor()\n" );
-      glClearColor( 0.5f, 0.5f, 0.5f, 1.0f );
+      *codepoint = ch & 0x07;
+      bytes = 4;
+   }
+
+   for( int i = 1; i < bytes; i++ )
+   {
+      // Never read past the terminator
+      if( string[ i ] == '\0' )
+      {
+         *codepoint = 0xFFFD;
+         return i;
+      }
+      *codepoint = ( *codepoint << 6 ) | ( ( unsigned char ) string[ i ] & 0x3F );
    }
+
+   return bytes;
 }
 
-static void gt_drawPoint( float x, float y )
+void gt_drawText( int x, int y, const char *string, const char *hexColor )
 {
-   glPointSize( 1.0 );
-   glBegin( GL_POINTS );
-      glVertex2f( x - 0.5, y + 1 - FONT_CELL_HEIGHT );
-   glEnd();
+   gt_drawTextColor( x, y, string, gt_hexColorPair( hexColor ) );
 }
 
-static void gt_drawChar( float x, float y, unsigned int codepoint, const char *colorString )
+// Cells that drawing goes to, those of the selected layer or the grid
+static GTCell *gt_targetCells( GT *gt, int *cols, int *rows )
 {
-   unsigned int *bitmap = gtFontMatrix[ codepoint ];
+   if( !gt )
+   {
+      return NULL;
+   }
+   if( gt->target )
+   {
+      *cols = gt->target->width;
+      *rows = gt->target->height;
+      return gt->target->cells;
+   }
+
+   *cols = gt->cellCols;
+   *rows = gt->cellRows;
+   return gt->cells;
+}
 
-   SDL_Color bgColor = { 255, 255, 255, 255 };
-   SDL_Color fgColor = { 0, 0, 0, 255};
+// Writes a string into one row up to column end, which lies inside the grid, and returns the column after it.
+// Wide characters fill two cells, the right one blank; zero-width characters such as combining marks take none
+static int gt_drawRun( GTCell *line, int x, int end, const char *string, gt_colorPair color )
+{
+   unsigned int codepoint;
 
-   if( colorString && strlen( colorString ) > 0 )
+   while( *string != '\0' && x < end )
    {
-      const char *separator = strchr( colorString, '/' );
-      if( separator && ( separator - colorString == 6 ) && strlen( separator + 1 ) == 6 )
-      {
-         char bgColorStr[ 7 ];
-         strncpy( bgColorStr, colorString, 6 );
-         bgColorStr[ 6 ] = '\0';
+      string += gt_utf8Decode( string, &codepoint );
 
-         bgColor = gt_hexToColor( bgColorStr );
-         fgColor = gt_hexToColor( separator + 1 );
+      int width = gt_charWidth( codepoint );
+      if( width == 0 )
+      {
+         continue;
       }
-   }
 
-   glColor4ub( bgColor.r, bgColor.g, bgColor.b, bgColor.a );
-   glBegin( GL_QUADS );
-      glVertex2f( x - 1, y );
-      glVertex2f( x + FONT_CELL_WIDTH, y );
-      glVertex2f( x + FONT_CELL_WIDTH, y - FONT_CELL_HEIGHT );
-      glVertex2f( x - 1, y - FONT_CELL_HEIGHT );
-   glEnd();
+      if( width == 2 && x + 1 >= end )
+      {
+         // Half a wide character is never drawn, the last column stays blank
+         codepoint = ' ';
+         width = 1;
+      }
 
-   glColor4ub( fgColor.r, fgColor.g, fgColor.b, fgColor.a );
-   for( int row = 0; row < FONT_CELL_HEIGHT; row++ )
-   {
-      unsigned int value = bitmap[ row ];
-      for( int col = 0; col < FONT_CELL_WIDTH; col++ )
+      // Codepoints beyond the BMP are kept, gt_glyphLookup() draws them with the fallback glyph
+      if( x >= 0 )
       {
-         if( value & ( 1 << ( 15 - col ) ) )
-         {
-            gt_drawPoint( x + col, y + row );
-         }
+         line[ x ] = ( GTCell ){ codepoint, color.fg, color.bg };
+      }
+      if( width == 2 && x + 1 >= 0 )
+      {
+         line[ x + 1 ] = ( GTCell ){ ' ', color.fg, color.bg };
       }
+
+      x += width;
    }
+
+   return x;
 }
 
-/* ------------------------------------------------------------------------- */
-// internal
-void check_open_gl_error( const char *stmt, const char *fname, int line, GLenum *errCode )
+void gt_drawTextColor( int x, int y, const char *string, gt_colorPair color )
 {
-   GLenum err = glGetError();
-   if( err != GL_NO_ERROR )
-   {
-      printf( "OpenGL error %08x, at %s:%i - for %s\n", err, fname, line, stmt );
-      *errCode = err;
-   }
-   else
+   int cols, rows;
+   GTCell *cells = gt_targetCells( gtCurrent, &cols, &rows );
+
+   if( !cells || y < 0 || y >= rows )
    {
-     *errCode = GL_NO_ERROR;
+      return;
    }
+
+   gt_drawRun( cells + y * cols, x, cols, string, color );
 }
 
-/* ------------------------------------------------------------------------- */
-// API functions
-GT *gt_createWindow( int width, int height, const char *title, const char *hexColor )
+// Draws at most maxCols columns of a string and returns how many it took, 0 past the end of the row; with pad the rest of
+// them is filled with blanks.
+// Replaces gt_drawText() of a gt_padRWidth() string without building one
+int gt_drawTextClipped( int x, int y, const char *string, int maxCols, bool pad, gt_colorPair color )
 {
-   setlocale( LC_ALL, "en_US.UTF-8" );
+   int cols, rows;
+   GTCell *cells = gt_targetCells( gtCurrent, &cols, &rows );
 
-   GT *gt = malloc( sizeof( GT ) );
-   if( !gt )
+   if( !cells || y < 0 || y >= rows || maxCols <= 0 )
    {
-      fprintf( stderr, "Memory allocation failed for GT structure.\n" );
-      return NULL;
+      return 0;
    }
 
-   memset( gt, 0, sizeof( GT ) );
-   gt->width = width;
-   gt->height = height;
-   gt->background = hexColor;
+   GTCell *line = cells + y * cols;
+   int end  = MIN( x + maxCols, cols );
+   int next = gt_drawRun( line, x, end, string, color );
 
-   if( SDL_Init( SDL_INIT_VIDEO ) != 0 )
+   if( pad )
    {
-      fprintf( stderr, "Unable to initialize SDL: %s\n", SDL_GetError() );
-      free( gt );
-      return NULL;
+      for( int col = MAX( next, 0 ); col < end; col++ )
+      {
+         line[ col ] = ( GTCell ){ ' ', color.fg, color.bg };
+      }
    }
 
-   gt->window = SDL_CreateWindow( title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE );
-   if( !gt->window )
+   return MAX( MIN( next, end ) - x, 0 );
+}
+
+// Every cell of the rectangle gets the codepoint, which should be a narrow one
+void gt_fillRect( int x, int y, int width, int height, unsigned int codepoint, gt_colorPair color )
+{
+   int cols, rows;
+   GTCell *cells = gt_targetCells( gtCurrent, &cols, &rows );
+
+   if( !cells || !gt_clipRect( cols, rows, &x, &y, &width, &height ) )
    {
-      fprintf( stderr, "Could not create window: %s\n", SDL_GetError() );
-      SDL_Quit();
-      free( gt );
-      return NULL;
+      return;
    }
 
-   gt->glContext = SDL_GL_CreateContext( gt->window );
-   if( !gt->glContext )
+   GTCell cell = { codepoint, color.fg, color.bg };
+   GTCell *first = cells + y * cols + x;
+
+   for( int col = 0; col < width; col++ )
    {
-      fprintf( stderr, "SDL_GL_CreateContext failed: %s\n", SDL_GetError() );
-      SDL_DestroyWindow( gt->window );
-      SDL_Quit();
-      free( gt );
-      return NULL;
+      first[ col ] = cell;
    }
+   for( int row = 1; row < height; row++ )
+   {
+      memcpy( first + row * cols, first, sizeof( GTCell ) * width );
+   }
+}
 
-   SDL_SetWindowMinimumSize( gt->window, width, height );
-
-   return gt;
+void gt_clearRect( int x, int y, int width, int height, gt_colorPair color )
+{
+   gt_fillRect( x, y, width, height, ' ', color );
 }
 
-void gt_clearAll( GT *gt )
+void gt_drawHLine( int x, int y, int length, unsigned int codepoint, gt_colorPair color )
 {
-   SDL_GL_DeleteContext( gt->glContext );
-   SDL_DestroyWindow( gt->window );
-   gt->window = NULL;
-   SDL_Quit();
+   gt_fillRect( x, y, length, 1, codepoint, color );
+}
 
-   free( gt );
-   gt = NULL;
+void gt_drawVLine( int x, int y, int length, unsigned int codepoint, gt_colorPair color )
+{
+   gt_fillRect( x, y, 1, length, codepoint, color );
 }
 
-void gt_beginDraw( GT *gt )
+// Moves what is on screen inside a cell rectangle dy rows down, or up when dy is negative, without rendering it again.
+// Call it before drawing into the rectangle: the moved rows are already in the frame, only the dy exposed rows are blank.
+// Returns F when nothing on screen can be reused, e.g. in the first frame, with a render thread or under a layer, and the whole
+// rectangle has to be drawn.
+bool gt_scrollRegion( int x, int y, int width, int height, int dy )
 {
-   int newWidth, newHeight;
-   int newWidthPos, newHeightPos;
-   int newMouseX, newMouseY;
+   GT *gt = gtCurrent;
 
-   SDL_GL_GetDrawableSize( gt->window, &newWidth, &newHeight );
-   gt->width = newWidth;
-   gt->height = newHeight;
+   if( !gt || !gt->cells || gt->fullRedraw || gt->target || gt->renderThread || !gt_clipRect( gt->cellCols, gt->cellRows, &x, &y, &width, &height ) || abs( dy ) >= height )
+   {
+      return F;
+   }
+
+   // The rows on screen have the layers in them, moving them would copy a layer into the grid
+   SDL_Rect area = { x, y, width, height };
+   if( gt_layersCover( gt, &area ) )
+   {
+      return F;
+   }
+
+   int rows = height - abs( dy );
+   int from = y + MAX( -dy, 0 );
+   int to   = y + MAX( dy, 0 );
+   int step = IIF( dy > 0, -1, 1 );
+   int first = IIF( dy > 0, rows - 1, 0 );
 
-   SDL_GetWindowPosition( gt->window, &newWidthPos, &newHeightPos ); // ?!
-   gt->widthPos = newWidthPos;
-   gt->heightPos = newHeightPos;
+   if( dy != 0 )
+   {
+      // The model of the screen moves first, the exposed rows keep what is still displayed there
+      for( int i = 0, row = first; i < rows; i++, row += step )
+      {
+         memcpy( gt->prevCells + ( to + row ) * gt->cellCols + x, gt->prevCells + ( from + row ) * gt->cellCols + x, sizeof( GTCell ) * width );
+      }
+      gt->backend->scroll( gt, x, width, from, to, rows );
+   }
 
-   SDL_GetMouseState( &newMouseX, &newMouseY );
-   gt->mouseX = newMouseX;
-   gt->mouseY = newMouseY;
+   int visibleRows = gt->height / gt->cellHeight;
+   for( int row = 0; row < rows; row++ )
+   {
+      GTCell *prevLine = gt->prevCells + ( to + row ) * gt->cellCols + x;
 
-   glViewport( 0, 0, newWidth, newHeight );
-   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-   gt_clearColor( gt->background );
+      memcpy( gt->cells + ( to + row ) * gt->cellCols + x, prevLine, sizeof( GTCell ) * width );
 
-   glDisable( GL_CULL_FACE );
-   glDisable( GL_DEPTH_TEST );
-   glEnable( GL_BLEND );
-   glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+      if( from + row >= visibleRows )
+      {
+         // A row cut off at the bottom edge was never fully drawn, render it again where it lands
+         for( int col = 0; col < width; col++ )
+         {
+            prevLine[ col ].codepoint = ( unsigned int ) -1;
+         }
+      }
+   }
 
-   glMatrixMode( GL_PROJECTION );
-   glLoadIdentity();
-   glOrtho( 0, newWidth, newHeight, 0, -1, 1 );
-   glMatrixMode( GL_MODELVIEW );
-   glLoadIdentity();
+   if( gt->scrolled.w > 0 )
+   {
+      SDL_UnionRect( &gt->scrolled, &area, &gt->scrolled );
+   }
+   else
+   {
+      gt->scrolled = area;
+   }
+   return T;
 }
 
-void gt_endDraw( GT *gt )
+/* ------------------------------------------------------------------------- */
+// layers
+// Starts a frame on top of the last one instead of a blank grid, so a program that only changes layers draws nothing else.
+// Returns F when the grid had to be rebuilt, e.g. after a resize; the grid is blank then, as after gt_beginDraw()
+bool gt_beginOverlay( GT *gt )
 {
-   REPORT_OPENGL_ERROR( "End drawing: " );
-   SDL_GL_SwapWindow( gt->window );
+   GTCell *cells = gt->cells;
+   int cols = gt->cellCols;
+   int rows = gt->cellRows;
+
+   gt_beginDraw( gt );
+
+   if( !gt->cells || gt->cells != cells || gt->cellCols != cols || gt->cellRows != rows )
+   {
+      return F;
+   }
+
+   // prevCells is the frame on screen, with the layers in it
+   memcpy( gt->cells, gt->prevCells, sizeof( GTCell ) * gt->cellCols * gt->cellRows );
+   gt_uncoverLayers( gt );
+   return T;
 }
 
-/* ------------------------------------------------------------------------- */
-SDL_Color gt_hexToColor( const char *hexColor )
+// Layers with a higher z are drawn over lower ones, equal ones in the order they were created
+GTLayer *gt_createLayer( GT *gt, int x, int y, int width, int height, int z )
 {
-   SDL_Color color = { 0, 0, 0, 255 };
-   int r, g, b, a = 255;
+   if( width <= 0 || height <= 0 || gt->layerCount == GT_MAX_LAYERS )
+   {
+      fprintf( stderr, "gt_createLayer: invalid size or too many layers.\n" );
+      return NULL;
+   }
 
-   if( strlen( hexColor ) == 6 ) // Format: RRGGBB
+   GTLayer *layer = calloc( 1, sizeof( GTLayer ) );
+   if( !layer )
    {
-      sscanf( hexColor, "%02x%02x%02x", &r, &g, &b );
-      color.r = r;
-      color.g = g;
-      color.b = b;
-      color.a = 255;
+      fprintf( stderr, "Memory allocation failed for layer.\n" );
+      return NULL;
    }
-   else if( strlen( hexColor ) == 8 ) // Format: RRGGBBAA
+
+   // Cells start out transparent
+   layer->cells = calloc( width * height, sizeof( GTCell ) );
+   layer->under = malloc( sizeof( GTCell ) * width * height );
+   if( !layer->cells || !layer->under )
    {
-      sscanf( hexColor, "%02x%02x%02x%02x", &r, &g, &b, &a );
-      color.r = r;
-      color.g = g;
-      color.b = b;
-      color.a = a;
+      fprintf( stderr, "Memory allocation failed for layer.\n" );
+      free( layer->cells );
+      free( layer->under );
+      free( layer );
+      return NULL;
    }
-   else
+
+   layer->gt = gt;
+   layer->x = x;
+   layer->y = y;
+   layer->width = width;
+   layer->height = height;
+   layer->z = z;
+   layer->visible = T;
+
+   int l = gt->layerCount++;
+   for( ; l > 0 && gt->layers[ l - 1 ]->z > z; l-- )
    {
-      fprintf( stderr, "Invalid hex color format: gt_hexToColor() - defaulting to gray.\n" );
-      color.r = 128;
-      color.g = 128;
-      color.b = 128;
-      color.a = 255;
+      gt->layers[ l ] = gt->layers[ l - 1 ];
    }
+   gt->layers[ l ] = layer;
 
-   return color;
+   gt_requestRedraw( gt );
+   return layer;
 }
 
-/* ------------------------------------------------------------------------- */
-void gt_drawText( int x, int y, const char *string, const char *hexColor )
+// The cells under the layer come back with the next frame, which also frees it
+void gt_closeLayer( GTLayer *layer )
 {
-   unsigned int codepoint;
-   int bytes;
-   unsigned char ch;
-   int i;
-
-   x = x * FONT_CELL_WIDTH + 1;
-   y = y * FONT_CELL_HEIGHT + FONT_CELL_HEIGHT;
-
-   while( *string != '\0' )
+   if( !layer )
    {
-      bytes = 0;
-      ch = ( unsigned char )( *string++ );
-      if( ch <= 0x7F )
-      {
-         codepoint = ch;
-         bytes = 1;
-      }
-      else if( ch <= 0xDF )
-      {
-         codepoint = ch & 0x1F;
-         bytes = 2;
-      }
-      else if( ch <= 0xEF )
-      {
-         codepoint = ch & 0x0F;
-         bytes = 3;
-      } else
-      {
-         codepoint = ch & 0x07;
-         bytes = 4;
-      }
+      return;
+   }
 
-      for( i = 1; i < bytes; i++ )
-      {
-         ch = ( unsigned char )( *string++ );
-         codepoint = ( codepoint << 6 ) | ( ch & 0x3F );
-      }
+   layer->closed = T;
+   layer->visible = F;
+   if( layer->gt->target == layer )
+   {
+      layer->gt->target = NULL;
+   }
+   gt_requestRedraw( layer->gt );
+}
 
-      gt_drawChar( x, y, codepoint, hexColor );
+void gt_moveLayer( GTLayer *layer, int x, int y )
+{
+   layer->x = x;
+   layer->y = y;
+   gt_requestRedraw( layer->gt );
+}
 
-      x += FONT_CELL_WIDTH;
-   }
+void gt_showLayer( GTLayer *layer, bool visible )
+{
+   layer->visible = visible;
+   gt_requestRedraw( layer->gt );
 }
 
+// Drawing functions write into the layer, in its own coordinates, until NULL selects the grid again or the frame ends
+void gt_selectLayer( GT *gt, GTLayer *layer )
+{
+   gt->target = layer && !layer->closed ? layer : NULL;
+}
 
 /* ------------------------------------------------------------------------- */
 int gt_maxCol( GT *gt )
 {
-   return gt->width / FONT_CELL_WIDTH;
+   return gt->width / gt->cellWidth;
 }
 
 int gt_maxRow( GT *gt )
 {
-   return gt->height / FONT_CELL_HEIGHT;
+   return gt->height / gt->cellHeight;
+}
+
+// Cell size in window coordinates, the unit of mouse events
+int gt_fontCellWidth( GT *gt )
+{
+   return MAX( 1, gt->cellWidth / gt->pixelRatio );
+}
+
+int gt_fontCellHeight( GT *gt )
+{
+   return MAX( 1, gt->cellHeight / gt->pixelRatio );
 }
 
 int gt_maxWidth( GT *gt )
@@ -641,48 +1735,169 @@ char *gt_subStr( const char *string, int start, int count )
 }
 
 /* ------------------------------------------------------------------------- */
-void gt_dispBox( int x, int y, int width, int height, const char *boxString, const char *hexColor )
+// the *Width variants count display columns instead of codepoints: wide characters count twice,
+// combining marks not at all, and a wide character is never split
+static const char *gt_utf8ColumnPtr( const char *string, int columns, int *width )
+{
+   unsigned int codepoint;
+   int used = 0;
+
+   while( *string )
+   {
+      int bytes = gt_utf8Decode( string, &codepoint );
+      int charWidth = gt_charWidth( codepoint );
+      if( used + charWidth > columns )
+      {
+         break;
+      }
+      used += charWidth;
+      string += bytes;
+   }
+
+   if( width )
+   {
+      *width = used;
+   }
+   return string;
+}
+
+static char *gt_padColumns( const char *string, int byteLen, int left, int right )
 {
-   if( strlen( boxString ) < 6 )
+   char *result = ( char * ) malloc( left + byteLen + right + 1 );
+   if( !result )
    {
-      fprintf( stderr, "Error: boxString must contain at least 6 UTF-8 characters.\n" );
-      return;
+      return NULL;
    }
 
-   // Buffers for individual UTF-8 box-drawing characters (maximum 4 bytes + 1 for '\0')
-   char topLeft[ 5 ]     = { 0 };
-   char horizontal[ 5 ]  = { 0 };
-   char topRight[ 5 ]    = { 0 };
-   char vertical[ 5 ]    = { 0 };
-   char bottomRight[ 5 ] = { 0 };
-   char bottomLeft[ 5 ]  = { 0 };
+   memset( result, ' ', left );
+   memcpy( result + left, string, byteLen );
+   memset( result + left + byteLen, ' ', right );
+   result[ left + byteLen + right ] = '\0';
+   return result;
+}
+
+char *gt_leftWidth( const char *string, int columns )
+{
+   const char *byteEnd = gt_utf8ColumnPtr( string, MAX( columns, 0 ), NULL );
+
+   return gt_padColumns( string, byteEnd - string, 0, 0 );
+}
+
+char *gt_padLWidth( const char *string, int columns )
+{
+   int padding = MAX( columns - ( int ) gt_utf8Width( string ), 0 );
+
+   return gt_padColumns( string, strlen( string ), padding, 0 );
+}
+
+char *gt_padCWidth( const char *string, int columns )
+{
+   int padding = MAX( columns - ( int ) gt_utf8Width( string ), 0 );
+
+   return gt_padColumns( string, strlen( string ), padding / 2, padding - padding / 2 );
+}
+
+char *gt_padRWidth( const char *string, int columns )
+{
+   int padding = MAX( columns - ( int ) gt_utf8Width( string ), 0 );
+
+   return gt_padColumns( string, strlen( string ), 0, padding );
+}
+
+// Columns start .. start + count - 1, counted from 0; a wide character cut in half at the start becomes a space
+char *gt_subStrWidth( const char *string, int start, int count )
+{
+   int total = gt_utf8Width( string );
+   int skipped;
+   int lead = 0;
+   unsigned int codepoint;
+
+   if( start < 0 )
+   {
+      start = MAX( total + start, 0 );
+   }
+   if( count <= 0 || start + count > total )
+   {
+      count = MAX( total - start, 0 );
+   }
+
+   const char *byteStart = gt_utf8ColumnPtr( string, start, &skipped );
+   if( skipped < start && *byteStart && count > 0 )
+   {
+      // Drop the straddling character together with the marks on it
+      byteStart += gt_utf8Decode( byteStart, &codepoint );
+      while( *byteStart )
+      {
+         int bytes = gt_utf8Decode( byteStart, &codepoint );
+         if( gt_charWidth( codepoint ) != 0 )
+         {
+            break;
+         }
+         byteStart += bytes;
+      }
 
-   // Extract each UTF-8 character from boxString
-   size_t index = 0;
-   gt_Utf8CharExtract( boxString, topLeft, &index );
-   gt_Utf8CharExtract( boxString, horizontal, &index );
-   gt_Utf8CharExtract( boxString, topRight, &index );
-   gt_Utf8CharExtract( boxString, vertical, &index );
-   gt_Utf8CharExtract( boxString, bottomRight, &index );
-   gt_Utf8CharExtract( boxString, bottomLeft, &index );
+      lead = 1;
+      count--;
+   }
+
+   const char *byteEnd = gt_utf8ColumnPtr( byteStart, count, NULL );
+
+   return gt_padColumns( byteStart, byteEnd - byteStart, lead, 0 );
+}
+
+/* ------------------------------------------------------------------------- */
+// box drawing
+const GTBox gtBoxSingle       = { 0x250C, 0x2500, 0x2510, 0x2502, 0x2518, 0x2514 };  // BOX_SINGLE
+const GTBox gtBoxDouble       = { 0x2554, 0x2550, 0x2557, 0x2551, 0x255D, 0x255A };  // BOX_DOUBLE
+const GTBox gtBoxSingleDouble = { 0x2553, 0x2500, 0x2556, 0x2551, 0x255C, 0x2559 };  // BOX_SINGLE_DOUBLE
+const GTBox gtBoxDoubleSingle = { 0x2552, 0x2550, 0x2555, 0x2502, 0x255B, 0x2558 };  // BOX_DOUBLE_SINGLE
+
+void gt_dispBox( int x, int y, int width, int height, const char *boxString, const char *hexColor )
+{
+   gt_dispBoxColor( x, y, width, height, boxString, gt_hexColorPair( hexColor ) );
+}
 
-   gt_drawText( x, y, topLeft, hexColor );                  // top-left corner
-   gt_drawText( x, y + height - 1, bottomLeft, hexColor );  // bottom-left corner
+void gt_dispBoxColor( int x, int y, int width, int height, const char *boxString, gt_colorPair color )
+{
+   GTBox box;
 
-   for( int i = 1; i < width - 1; i++ )
+   if( !gt_boxDecode( boxString, &box ) )
    {
-      gt_drawText( x + i, y, horizontal, hexColor );               // top edge
-      gt_drawText( x + i, y + height - 1, horizontal, hexColor );  // bottom edge
+      fprintf( stderr, "Error: boxString must contain at least 6 UTF-8 characters.\n" );
+      return;
    }
 
-   for( int i = 1; i < height - 1; i++ )
+   gt_drawBox( x, y, width, height, &box, color );
+}
+
+// Splits a string of six box characters like BOX_SINGLE into codepoints, so drawing the box decodes nothing
+bool gt_boxDecode( const char *boxString, GTBox *box )
+{
+   unsigned int *parts[ 6 ] = { &box->topLeft, &box->horizontal, &box->topRight, &box->vertical, &box->bottomRight, &box->bottomLeft };
+
+   for( int i = 0; i < 6; i++ )
    {
-      gt_drawText( x, y + i, vertical, hexColor );              // left edge
-      gt_drawText( x + width - 1, y + i, vertical, hexColor );  // right edge
+      if( *boxString == '\0' )
+      {
+         return F;
+      }
+      boxString += gt_utf8Decode( boxString, parts[ i ] );
    }
 
-   gt_drawText( x + width - 1, y, topRight, hexColor );                  // top-right corner
-   gt_drawText( x + width - 1, y + height - 1, bottomRight, hexColor );  // bottom-right corner
+   return T;
+}
+
+void gt_drawBox( int x, int y, int width, int height, const GTBox *box, gt_colorPair color )
+{
+   gt_drawHLine( x + 1, y, width - 2, box->horizontal, color );               // top edge
+   gt_drawHLine( x + 1, y + height - 1, width - 2, box->horizontal, color );  // bottom edge
+   gt_drawVLine( x, y + 1, height - 2, box->vertical, color );                // left edge
+   gt_drawVLine( x + width - 1, y + 1, height - 2, box->vertical, color );    // right edge
+
+   gt_fillRect( x, y, 1, 1, box->topLeft, color );
+   gt_fillRect( x, y + height - 1, 1, 1, box->bottomLeft, color );
+   gt_fillRect( x + width - 1, y, 1, 1, box->topRight, color );
+   gt_fillRect( x + width - 1, y + height - 1, 1, 1, box->bottomRight, color );
 }
 
 /* ------------------------------------------------------------------------- */
@@ -778,6 +1993,21 @@ size_t gt_utf8LenUpTo( const char *utf8String, const char *endPosition )
    return len;
 }
 
+// Display columns of a string, see gt_charWidth()
+size_t gt_utf8Width( const char *utf8String )
+{
+   unsigned int codepoint;
+   size_t width = 0;
+
+   while( *utf8String )
+   {
+      utf8String += gt_utf8Decode( utf8String, &codepoint );
+      width += gt_charWidth( codepoint );
+   }
+
+   return width;
+}
+
 /* ------------------------------------------------------------------------- */
 const char *gt_cwd( void )
 {
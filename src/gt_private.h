@@ -0,0 +1,184 @@
+/*
+ *
+ */
+
+#ifndef GT_PRIVATE_H_
+#define GT_PRIVATE_H_
+
+// Internals shared by the GT sources and the rendering backends, not installed with gt.h
+#include "gt.h"
+
+/* ------------------------------------------------------------------------- */
+// rendering backends, one per GTRenderer; gt_createWindowEx() picks one and the frame loop only calls through it
+struct _GTBackend
+{
+   const char      *name;      // value of GT_RENDERER
+   GTRenderer       renderer;
+   const GTBackend *fallback;  // tried when init fails, NULL for none
+
+   bool ( *init )( GT *gt, const char *title );                // SDL, window and context; F leaves nothing to free
+   void ( *beginFrame )( GT *gt, int *width, int *height );    // size of the frame in pixels, called on the drawing thread
+   void ( *resize )( GT *gt );                                 // the grid was reallocated, cell sizes are set
+   void ( *submit )( GT *gt );                                 // renders the cells in gt->damage
+   void ( *present )( GT *gt );                                // shows what submit rendered
+   void ( *scroll )( GT *gt, int x, int width, int from, int to, int rows );  // moves retained pixels, see gt_scrollRegion()
+   bool ( *readPixels )( GT *gt, int x, int y, int width, int height, gt_color *pixels );
+   void ( *destroy )( GT *gt );                                // frees what init and resize created
+};
+
+extern const GTBackend gtBackendGLLegacy;
+extern const GTBackend gtBackendGLCore;
+extern const GTBackend gtBackendSoftware;
+extern const GTBackend gtBackendHeadless;
+extern const GTBackend gtBackendTerminal;
+
+bool gt_termResized( GT *gt );  // backend_term.c, see gt_frameDue()
+
+/* ------------------------------------------------------------------------- */
+// gt.c
+bool gt_openWindow( GT *gt, const char *title, Uint32 flags );
+void gt_closeWindow( GT *gt );
+void gt_collectDamage( GT *gt );
+void gt_resizeGrid( GT *gt, int cols, int rows );
+void gt_presentFrame( GT *gt );
+GT  *gt_otherWindow( const GT *gt, const GTBackend *backend );
+int  gt_windowCount( void );
+void check_open_gl_error( const char *stmt, const char *fname, int line, GLenum *errCode );
+
+/* ------------------------------------------------------------------------- */
+// render_thread.c
+void gt_publishFrame( GT *gt );
+void gt_requestSync( GT *gt, GTSync sync );
+
+/* ------------------------------------------------------------------------- */
+// stats.c
+void gt_statsBegin( GT *gt );
+void gt_statsEnd( GT *gt );
+void gt_freeStats( GT *gt );
+
+/* ------------------------------------------------------------------------- */
+// _linux.c and _win.c, the terminal on stdout
+bool gt_terminalOpen( void );
+void gt_terminalClose( void );
+bool gt_terminalSize( int *cols, int *rows );
+void gt_terminalWrite( const char *bytes, size_t length );
+int  gt_terminalRead( char *buffer, size_t size, int timeout, bool *resized );
+void gt_terminalWake( void );
+
+// _linux.c and _win.c, frame statistics
+long   gt_processId( void );
+Uint64 gt_threadCpuTime( void );
+bool   gt_replaceFile( const char *from, const char *to );
+int    gt_socketListen( const char *path );
+int    gt_socketAccept( int listener );
+void   gt_socketSend( int socket, const char *bytes, size_t length );
+void   gt_socketShutdown( int listener );
+void   gt_socketClose( int socket );
+
+/* ------------------------------------------------------------------------- */
+// backend_gl.c, OpenGL plumbing shared by the legacy and the core renderer
+#define ATLAS_SIZE 2048
+
+// One atlas per font in use in a context group, the legacy and the core renderer do not share contexts
+typedef struct
+{
+   GLuint          texture;
+   GLuint          lookup;              // codepoint -> slot, core profile only
+   GLenum          format;              // GL_RED on core profile contexts, GL_ALPHA otherwise
+   unsigned short  slot[ ENCODING ];    // 0 = not rasterized yet
+   int             next;                // slot 0 is a solid block
+   const GTFont   *font;                // font the slots were rasterized from
+   int             cols;                // slots per atlas row, ATLAS_SIZE / font width
+   int             slots;
+   int             users;               // windows of the group drawing with the font
+} GTAtlas;
+
+extern GTAtlas *gtAtlas;  // set by gt_atlasUse()
+
+typedef struct _GTGLDebug GTGLDebug;
+
+// gt->backendData of a window of either OpenGL renderer, created by gt_glCreateContext()
+typedef struct
+{
+   GTAtlas        *atlas;               // of the window's font, see gt_atlasUse()
+   GLuint          canvasTexture;       // legacy renderer, 0 without framebuffer objects
+   GLuint          canvasFramebuffer;
+   GLuint          program;             // core renderer
+   GLuint          vertexArray;
+   GLuint          instanceBuffer;
+   GLint           uCols;               // uniform locations of the program, looked up once it is linked
+   GLint           uViewport;
+   GLint           uCell;
+   GLint           uGlyph;
+   GLint           uAtlasCols;
+   GTGLDebug      *debug;               // GT_GL_DEBUG builds, see backend_gl_debug.c
+} GTGLWindow;
+
+// Calls and bytes since the last present, gt_glPresent() adds them to the window's frameCounts
+extern int    gtGLCalls;
+extern size_t gtGLBytes;
+
+extern PFNGLGENFRAMEBUFFERSPROC        gt_glGenFramebuffers;
+extern PFNGLDELETEFRAMEBUFFERSPROC     gt_glDeleteFramebuffers;
+extern PFNGLBINDFRAMEBUFFERPROC        gt_glBindFramebuffer;
+extern PFNGLFRAMEBUFFERTEXTURE2DPROC   gt_glFramebufferTexture2D;
+extern PFNGLCHECKFRAMEBUFFERSTATUSPROC gt_glCheckFramebufferStatus;
+extern PFNGLBLITFRAMEBUFFERPROC        gt_glBlitFramebuffer;
+
+extern PFNGLGENBUFFERSPROC    gt_glGenBuffers;
+extern PFNGLDELETEBUFFERSPROC gt_glDeleteBuffers;
+extern PFNGLBINDBUFFERPROC    gt_glBindBuffer;
+extern PFNGLBUFFERDATAPROC    gt_glBufferData;
+extern PFNGLBUFFERSUBDATAPROC gt_glBufferSubData;
+
+void gt_clearColor( gt_color color );
+bool gt_atlasUse( GT *gt );
+void gt_atlasRelease( GT *gt );
+int  gt_atlasGlyph( unsigned int codepoint );
+bool gt_loadFramebufferFunctions( void );
+bool gt_loadBufferFunctions( void );
+
+bool gt_glCreateContext( GT *gt, const char *title );
+void gt_glMakeCurrent( GT *gt );
+void gt_glBeginFrame( GT *gt, int *width, int *height );
+void gt_glPresent( GT *gt );
+bool gt_glReadPixels( GT *gt, int x, int y, int width, int height, gt_color *pixels );
+void gt_glDestroy( GT *gt );
+
+/* ------------------------------------------------------------------------- */
+// backend_gl_debug.c, GPU timers and the GL debug log; builds without GT_GL_DEBUG compile the calls away
+#ifdef GT_GL_DEBUG
+void gt_glDebugInit( GT *gt );
+void gt_glDebugFree( GT *gt );
+void gt_glTimerBegin( GT *gt, GTGpuPhase phase );
+void gt_glTimerEnd( GT *gt, GTGpuPhase phase );
+void gt_glTimerFrame( GT *gt );
+#else
+#define gt_glDebugInit( gt )             ( ( void ) 0 )
+#define gt_glDebugFree( gt )             ( ( void ) 0 )
+#define gt_glTimerBegin( gt, phase )     ( ( void ) 0 )
+#define gt_glTimerEnd( gt, phase )       ( ( void ) 0 )
+#define gt_glTimerFrame( gt )            ( ( void ) 0 )
+#endif
+
+/* ------------------------------------------------------------------------- */
+// USDT probes of provider "gt" for bpftrace, perf and SystemTap, see docs/README.md. A disabled probe is a NOP;
+// where sys/sdt.h is missing, or with GT_NO_PROBES, the probes are compiled away.
+#if !defined( GT_NO_PROBES ) && defined( __linux__ ) && defined( __has_include )
+#if __has_include( <sys/sdt.h> )
+#include <sys/sdt.h>
+#define GT_PROBES
+#endif
+#endif
+
+#ifdef GT_PROBES
+#define GT_PROBE1( name, a )          DTRACE_PROBE1( gt, name, a )
+#define GT_PROBE2( name, a, b )       DTRACE_PROBE2( gt, name, a, b )
+#define GT_PROBE3( name, a, b, c )    DTRACE_PROBE3( gt, name, a, b, c )
+#else
+#define GT_PROBE1( name, a )          ( ( void ) 0 )
+#define GT_PROBE2( name, a, b )       ( ( void ) 0 )
+#define GT_PROBE3( name, a, b, c )    ( ( void ) 0 )
+#endif
+
+#endif /* End GT_PRIVATE_H_ */
@@ -0,0 +1,279 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// render thread: gt_endDraw() publishes a copy of the cell grid and returns, the thread renders the newest copy.
+// Three slots are passed around by exchanging one atomic index, so neither side ever waits for the other:
+// the drawing thread fills its own slot and swaps it with the latest one, the render thread swaps its slot
+// with the latest one when that is marked fresh. A frame the render thread had no time for is overwritten.
+#define GT_SNAPSHOT_FRESH 4  // added to a slot index, the latest slot was not taken yet
+
+typedef struct
+{
+   GTCell       *cells;     // immutable once published
+   size_t        capacity;  // cells allocated
+   int           cols;
+   int           rows;
+   int           width;
+   int           height;
+   int           cellWidth;
+   int           cellHeight;
+   int           scale;
+   int           pixelRatio;
+   const GTFont *font;
+   gt_color      backgroundColor;
+} GTSnapshot;
+
+struct _GTRenderThread
+{
+   GT          *view;        // the window as the render thread sees it, owns the backend while the thread runs
+   SDL_Thread  *thread;
+   SDL_sem     *wake;        // posted once per published frame
+   SDL_atomic_t latest;      // slot index, plus GT_SNAPSHOT_FRESH
+   SDL_atomic_t fullRedraw;  // the next frame rendered has to redraw every cell
+   SDL_atomic_t sync;        // GTSync + 1 for gt_setSync() to apply, 0 for none
+   SDL_atomic_t quit;
+   GTSnapshot   slots[ 3 ];
+   int          writing;     // slot of the drawing thread
+   int          reading;     // slot of the render thread
+};
+
+static int gt_renderThreadMain( void *data )
+{
+   GTRenderThread *rt = data;
+   GT *view = rt->view;
+
+   if( view->glContext )
+   {
+      SDL_GL_MakeCurrent( view->window, view->glContext );
+   }
+
+   while( SDL_SemWait( rt->wake ) == 0 && !SDL_AtomicGet( &rt->quit ) )
+   {
+      if( !( SDL_AtomicGet( &rt->latest ) & GT_SNAPSHOT_FRESH ) )
+      {
+         // Posted for a frame that a later wake-up already rendered
+         continue;
+      }
+      rt->reading = SDL_AtomicSet( &rt->latest, rt->reading ) & ~GT_SNAPSHOT_FRESH;
+      SDL_MemoryBarrierAcquire();
+
+      const GTSnapshot *frame = &rt->slots[ rt->reading ];
+
+      int sync = SDL_AtomicSet( &rt->sync, 0 );
+      if( sync > 0 )
+      {
+         gt_setSync( view, ( GTSync )( sync - 1 ) );
+      }
+
+      view->width           = frame->width;
+      view->height          = frame->height;
+      view->scale           = frame->scale;
+      view->pixelRatio      = frame->pixelRatio;
+      view->font            = frame->font;
+      view->backgroundColor = frame->backgroundColor;
+
+      if( !view->cells || frame->cols != view->cellCols || frame->rows != view->cellRows ||
+          frame->cellWidth != view->cellWidth || frame->cellHeight != view->cellHeight )
+      {
+         view->cellWidth  = frame->cellWidth;
+         view->cellHeight = frame->cellHeight;
+         gt_resizeGrid( view, frame->cols, frame->rows );
+         if( frame->cols != view->cellCols || frame->rows != view->cellRows )
+         {
+            continue;
+         }
+      }
+      if( SDL_AtomicSet( &rt->fullRedraw, 0 ) )
+      {
+         view->fullRedraw = T;
+      }
+
+      memcpy( view->cells, frame->cells, sizeof( GTCell ) * frame->cols * frame->rows );
+      gt_presentFrame( view );
+      memset( &view->frameCounts, 0, sizeof( GTFrameStats ) );
+   }
+
+   if( view->glContext )
+   {
+      SDL_GL_MakeCurrent( view->window, NULL );
+   }
+   return 0;
+}
+
+// The backend's state moves between the window and the view, whatever the backend keeps in it
+static void gt_moveBackend( GT *to, const GT *from )
+{
+   to->backendData = from->backendData;
+}
+
+static void gt_freeRenderThread( GTRenderThread *rt )
+{
+   for( int s = 0; s < 3; s++ )
+   {
+      free( rt->slots[ s ].cells );
+   }
+   if( rt->wake )
+   {
+      SDL_DestroySemaphore( rt->wake );
+   }
+   if( rt->view )
+   {
+      free( rt->view->cells );
+      free( rt->view->prevCells );
+      free( rt->view );
+   }
+   free( rt );
+}
+
+/* ------------------------------------------------------------------------- */
+// Renders and presents on a thread of its own from the next frame on, until gt_stopRenderThread() or gt_clearAll().
+// The program keeps drawing and handling events on its thread; gt_endDraw() no longer waits for the swap.
+bool gt_startRenderThread( GT *gt )
+{
+   if( gt->renderThread )
+   {
+      return T;
+   }
+   if( gt_windowCount() > 1 )
+   {
+      // The glyph caches and the context group of the windows are not locked
+      fprintf( stderr, "The render thread needs the window to be the only one open.\n" );
+      return F;
+   }
+
+   GTRenderThread *rt = malloc( sizeof( GTRenderThread ) );
+   if( !rt )
+   {
+      fprintf( stderr, "Memory allocation failed for render thread.\n" );
+      return F;
+   }
+   memset( rt, 0, sizeof( GTRenderThread ) );
+
+   // Each side owns a different slot from the start, slot 0 is the latest one and not fresh
+   rt->writing = 1;
+   rt->reading = 2;
+
+   rt->view = malloc( sizeof( GT ) );
+   rt->wake = SDL_CreateSemaphore( 0 );
+   if( !rt->view || !rt->wake )
+   {
+      fprintf( stderr, "Unable to start the render thread: %s\n", SDL_GetError() );
+      gt_freeRenderThread( rt );
+      return F;
+   }
+
+   // The view starts without a grid, so its first frame is drawn in full
+   *rt->view = *gt;
+   rt->view->cells        = NULL;
+   rt->view->prevCells    = NULL;
+   rt->view->layerCount   = 0;
+   rt->view->target       = NULL;
+   rt->view->scrolled.w   = 0;
+   rt->view->renderThread = NULL;
+   rt->view->stats        = NULL;
+
+   if( gt->glContext )
+   {
+      SDL_GL_MakeCurrent( gt->window, NULL );
+   }
+
+   rt->thread = SDL_CreateThread( gt_renderThreadMain, "gt render", rt );
+   if( !rt->thread )
+   {
+      fprintf( stderr, "Unable to start the render thread: %s\n", SDL_GetError() );
+      if( gt->glContext )
+      {
+         SDL_GL_MakeCurrent( gt->window, gt->glContext );
+      }
+      gt_freeRenderThread( rt );
+      return F;
+   }
+
+   gt->renderThread = rt;
+   return T;
+}
+
+// Waits for the frame being rendered, then renders on the calling thread again
+void gt_stopRenderThread( GT *gt )
+{
+   GTRenderThread *rt = gt->renderThread;
+
+   if( !rt )
+   {
+      return;
+   }
+
+   SDL_AtomicSet( &rt->quit, 1 );
+   SDL_SemPost( rt->wake );
+   SDL_WaitThread( rt->thread, NULL );
+
+   GT *view = rt->view;
+   gt_moveBackend( gt, view );
+   if( gt->glContext )
+   {
+      SDL_GL_MakeCurrent( gt->window, gt->glContext );
+   }
+   gt->renderThread = NULL;
+
+   // The backend was sized for the view's grid; the last frame the thread published may not be on screen
+   if( gt->cells && ( gt->cellCols != view->cellCols || gt->cellRows != view->cellRows ||
+                      gt->cellWidth != view->cellWidth || gt->cellHeight != view->cellHeight ) )
+   {
+      gt->backend->resize( gt );
+   }
+   gt->fullRedraw = T;
+   gt->redrawRequested = T;
+
+   gt_freeRenderThread( rt );
+}
+
+// Copies the composited grid into the drawing thread's slot and makes it the latest frame
+void gt_publishFrame( GT *gt )
+{
+   GTRenderThread *rt = gt->renderThread;
+   GTSnapshot *frame = &rt->slots[ rt->writing ];
+   size_t count = ( size_t ) gt->cellCols * gt->cellRows;
+
+   if( frame->capacity < count )
+   {
+      GTCell *cells = realloc( frame->cells, sizeof( GTCell ) * count );
+      if( !cells )
+      {
+         fprintf( stderr, "Memory allocation failed for render thread frame.\n" );
+         return;
+      }
+      frame->cells    = cells;
+      frame->capacity = count;
+   }
+
+   memcpy( frame->cells, gt->cells, sizeof( GTCell ) * count );
+   frame->cols            = gt->cellCols;
+   frame->rows            = gt->cellRows;
+   frame->width           = gt->width;
+   frame->height          = gt->height;
+   frame->cellWidth       = gt->cellWidth;
+   frame->cellHeight      = gt->cellHeight;
+   frame->scale           = gt->scale;
+   frame->pixelRatio      = gt->pixelRatio;
+   frame->font            = gt->font;
+   frame->backgroundColor = gt->backgroundColor;
+
+   if( gt->fullRedraw )
+   {
+      SDL_AtomicSet( &rt->fullRedraw, 1 );
+   }
+
+   SDL_MemoryBarrierRelease();
+   rt->writing = SDL_AtomicSet( &rt->latest, rt->writing | GT_SNAPSHOT_FRESH ) & ~GT_SNAPSHOT_FRESH;
+   SDL_SemPost( rt->wake );
+}
+
+// gt_setSync() while the thread runs, the swap interval belongs to the context on that thread
+void gt_requestSync( GT *gt, GTSync sync )
+{
+   SDL_AtomicSet( &gt->renderThread->sync, ( int ) sync + 1 );
+}
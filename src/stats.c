@@ -0,0 +1,340 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// frame statistics: gt_beginDraw() and gt_endDraw() time each frame, the renderer counts what it did in
+// gt->frameCounts. Percentiles are taken over the last GT_STATS_FRAMES frames.
+#define GT_STATS_FRAMES   256
+#define GT_STATS_INTERVAL 1000  // milliseconds between two exports
+#define GT_STATS_TEXT     1024
+
+struct _GTStats
+{
+   Uint64        begin;                       // SDL_GetPerformanceCounter() at gt_beginDraw()
+   Uint64        beginCpu;                    // gt_threadCpuTime() at gt_beginDraw()
+   GTFrameStats  last;
+   float         frameMs[ GT_STATS_FRAMES ];  // ring of the latest frames
+   float         cpuMs[ GT_STATS_FRAMES ];
+   int           next;
+   int           count;
+
+   // export, see gt_exportStats(); the drawing thread only formats text, the exporter thread writes or serves it
+   char         *path;                        // file rewritten every GT_STATS_INTERVAL or the socket, NULL for none
+   int           listener;                    // -1 unless path is a Unix socket
+   SDL_Thread   *exporter;
+   SDL_sem      *wake;                        // posted to stop the writer of a file
+   SDL_mutex    *lock;                        // guards text while the exporter runs
+   char          text[ GT_STATS_TEXT ];
+   Uint32        exported;                    // SDL_GetTicks() of the last export
+};
+
+static int gt_compareFloat( const void *a, const void *b )
+{
+   float x = *( const float * ) a;
+   float y = *( const float * ) b;
+   return ( x > y ) - ( x < y );
+}
+
+// Nearest rank percentiles of a ring, p50, p95 and p99
+static void gt_percentiles( const float *ring, int count, double *p50, double *p95, double *p99 )
+{
+   float sorted[ GT_STATS_FRAMES ];
+
+   if( count == 0 )
+   {
+      *p50 = *p95 = *p99 = 0.0;
+      return;
+   }
+
+   memcpy( sorted, ring, sizeof( float ) * count );
+   qsort( sorted, count, sizeof( float ), gt_compareFloat );
+
+   *p50 = sorted[ ( count * 50 + 99 ) / 100 - 1 ];
+   *p95 = sorted[ ( count * 95 + 99 ) / 100 - 1 ];
+   *p99 = sorted[ ( count * 99 + 99 ) / 100 - 1 ];
+}
+
+static GTStats *gt_stats( GT *gt )
+{
+   if( !gt->stats )
+   {
+      gt->stats = malloc( sizeof( GTStats ) );
+      if( !gt->stats )
+      {
+         fprintf( stderr, "Memory allocation failed for frame statistics.\n" );
+         return NULL;
+      }
+      memset( gt->stats, 0, sizeof( GTStats ) );
+      gt->stats->listener = -1;
+   }
+   return gt->stats;
+}
+
+/* ------------------------------------------------------------------------- */
+// export: one "name value" pair per line, the format of a Prometheus text exposition without labels
+static void gt_formatStats( GT *gt, const GTFrameStats *stats, char *text, size_t size )
+{
+   snprintf( text, size,
+             "# gt frame statistics of pid %ld, %s renderer\n"
+             "gt_frames %llu\n"
+             "gt_frame_ms %.3f\n"
+             "gt_frame_ms_p50 %.3f\n"
+             "gt_frame_ms_p95 %.3f\n"
+             "gt_frame_ms_p99 %.3f\n"
+             "gt_cpu_ms %.3f\n"
+             "gt_cpu_ms_p50 %.3f\n"
+             "gt_cpu_ms_p95 %.3f\n"
+             "gt_cpu_ms_p99 %.3f\n"
+             "gt_cells_submitted %d\n"
+             "gt_cells_changed %d\n"
+             "gt_glyphs %d\n"
+             "gt_gl_calls %d\n"
+             "gt_bytes_uploaded %lu\n",
+             ( long ) gt_processId(), gt->backend->name,
+             ( unsigned long long ) stats->frames,
+             stats->frameMs, stats->frameMsP50, stats->frameMsP95, stats->frameMsP99,
+             stats->cpuMs, stats->cpuMsP50, stats->cpuMsP95, stats->cpuMsP99,
+             stats->cellsSubmitted, stats->cellsChanged, stats->glyphs, stats->glCalls,
+             ( unsigned long ) stats->bytesUploaded );
+}
+
+// Written next to the file and renamed over it, a scraper never reads half of it
+static void gt_writeStatsFile( const char *path, const char *text )
+{
+   char temp[ PATH_MAX ];
+
+   snprintf( temp, sizeof( temp ), "%s.tmp", path );
+
+   FILE *file = fopen( temp, "w" );
+   if( !file )
+   {
+      return;
+   }
+   bool written = fputs( text, file ) >= 0;
+   if( fclose( file ) != 0 || !written || !gt_replaceFile( temp, path ) )
+   {
+      remove( temp );
+   }
+}
+
+// Every connection gets the latest text and is closed, the way a scraper expects it
+static int gt_statsServer( void *data )
+{
+   GTStats *stats = data;
+   char text[ GT_STATS_TEXT ];
+   int client;
+
+   while( ( client = gt_socketAccept( stats->listener ) ) >= 0 )
+   {
+      SDL_LockMutex( stats->lock );
+      memcpy( text, stats->text, sizeof( text ) );
+      SDL_UnlockMutex( stats->lock );
+
+      gt_socketSend( client, text, strlen( text ) );
+      gt_socketClose( client );
+   }
+   return 0;
+}
+
+// Rewrites the file every GT_STATS_INTERVAL until gt_stopExport(), also while the window draws nothing
+static int gt_statsWriter( void *data )
+{
+   GTStats *stats = data;
+   char text[ GT_STATS_TEXT ];
+
+   do
+   {
+      SDL_LockMutex( stats->lock );
+      memcpy( text, stats->text, sizeof( text ) );
+      SDL_UnlockMutex( stats->lock );
+
+      gt_writeStatsFile( stats->path, text );
+   }
+   while( SDL_SemWaitTimeout( stats->wake, GT_STATS_INTERVAL ) == SDL_MUTEX_TIMEDOUT );
+   return 0;
+}
+
+static void gt_stopExport( GTStats *stats )
+{
+   if( stats->exporter )
+   {
+      if( stats->listener >= 0 )
+      {
+         gt_socketShutdown( stats->listener );
+      }
+      else
+      {
+         SDL_SemPost( stats->wake );
+      }
+      SDL_WaitThread( stats->exporter, NULL );
+      stats->exporter = NULL;
+   }
+   if( stats->listener >= 0 )
+   {
+      gt_socketClose( stats->listener );
+      stats->listener = -1;
+      remove( stats->path );
+   }
+   if( stats->wake )
+   {
+      SDL_DestroySemaphore( stats->wake );
+      stats->wake = NULL;
+   }
+   if( stats->lock )
+   {
+      SDL_DestroyMutex( stats->lock );
+      stats->lock = NULL;
+   }
+   free( stats->path );
+   stats->path = NULL;
+}
+
+// Formats the text the exporter thread hands out next, no I/O on the drawing thread
+static void gt_export( GT *gt, GTStats *stats )
+{
+   GTFrameStats current = gt_getFrameStats( gt );
+   char text[ GT_STATS_TEXT ];
+
+   gt_formatStats( gt, &current, text, sizeof( text ) );
+
+   SDL_LockMutex( stats->lock );
+   memcpy( stats->text, text, sizeof( text ) );
+   SDL_UnlockMutex( stats->lock );
+
+   stats->exported = SDL_GetTicks();
+}
+
+/* ------------------------------------------------------------------------- */
+// called by gt_beginDraw(), gt_endDraw() and gt_clearAll()
+void gt_statsBegin( GT *gt )
+{
+   GTStats *stats = gt_stats( gt );
+
+   if( stats )
+   {
+      stats->begin    = SDL_GetPerformanceCounter();
+      stats->beginCpu = gt_threadCpuTime();
+   }
+}
+
+// Called at the end of gt_endDraw(), the renderer's counters start from 0 again
+void gt_statsEnd( GT *gt )
+{
+   GTStats *stats = gt->stats;
+
+   if( stats && stats->begin )
+   {
+      GTFrameStats *last = &stats->last;
+
+      last->frames++;
+      last->frameMs = ( double )( SDL_GetPerformanceCounter() - stats->begin ) * 1000.0 / SDL_GetPerformanceFrequency();
+      last->cpuMs   = ( double )( gt_threadCpuTime() - stats->beginCpu ) / 1000000.0;
+
+      last->cellsSubmitted = gt->frameCounts.cellsSubmitted;
+      last->cellsChanged   = gt->frameCounts.cellsChanged;
+      last->glyphs         = gt->frameCounts.glyphs;
+      last->glCalls        = gt->frameCounts.glCalls;
+      last->bytesUploaded  = gt->frameCounts.bytesUploaded;
+
+      stats->frameMs[ stats->next ] = ( float ) last->frameMs;
+      stats->cpuMs[ stats->next ]   = ( float ) last->cpuMs;
+      stats->next  = ( stats->next + 1 ) % GT_STATS_FRAMES;
+      stats->count = MIN( stats->count + 1, GT_STATS_FRAMES );
+      stats->begin = 0;
+
+      if( stats->path && SDL_GetTicks() - stats->exported >= GT_STATS_INTERVAL )
+      {
+         gt_export( gt, stats );
+      }
+   }
+
+   memset( &gt->frameCounts, 0, sizeof( GTFrameStats ) );
+}
+
+void gt_freeStats( GT *gt )
+{
+   if( gt->stats )
+   {
+      gt_stopExport( gt->stats );
+      free( gt->stats );
+      gt->stats = NULL;
+   }
+}
+
+/* ------------------------------------------------------------------------- */
+// The last frame ended by gt_endDraw() and percentiles of the frames before it; all 0 before the first frame.
+// While a render thread runs only the times are measured, the renderer's counters stay 0.
+GTFrameStats gt_getFrameStats( GT *gt )
+{
+   GTFrameStats result;
+   GTStats *stats = gt->stats;
+
+   memset( &result, 0, sizeof( GTFrameStats ) );
+   if( stats )
+   {
+      result = stats->last;
+      gt_percentiles( stats->frameMs, stats->count, &result.frameMsP50, &result.frameMsP95, &result.frameMsP99 );
+      gt_percentiles( stats->cpuMs, stats->count, &result.cpuMsP50, &result.cpuMsP95, &result.cpuMsP99 );
+   }
+   return result;
+}
+
+// Publishes the statistics about once a second, to a file rewritten in place or to every client of a
+// Unix socket given as "unix:/path"; NULL stops exporting
+bool gt_exportStats( GT *gt, const char *target )
+{
+   GTStats *stats = gt_stats( gt );
+
+   if( !stats )
+   {
+      return F;
+   }
+
+   gt_stopExport( stats );
+   if( !target || !*target )
+   {
+      return T;
+   }
+
+   bool socket = strncmp( target, "unix:", 5 ) == 0;
+   if( socket )
+   {
+      target += 5;
+   }
+
+   stats->path = malloc( strlen( target ) + 1 );
+   if( !stats->path )
+   {
+      fprintf( stderr, "Memory allocation failed for statistics path.\n" );
+      return F;
+   }
+   strcpy( stats->path, target );
+
+   stats->lock = SDL_CreateMutex();
+   if( socket )
+   {
+      stats->listener = gt_socketListen( stats->path );
+   }
+   else
+   {
+      stats->wake = SDL_CreateSemaphore( 0 );
+   }
+   if( !stats->lock || ( socket && stats->listener < 0 ) || ( !socket && !stats->wake ) )
+   {
+      gt_stopExport( stats );
+      return F;
+   }
+
+   gt_export( gt, stats );
+   stats->exporter = SDL_CreateThread( IIF( socket, gt_statsServer, gt_statsWriter ), "gt stats", stats );
+   if( !stats->exporter )
+   {
+      fprintf( stderr, "Unable to start the statistics exporter: %s\n", SDL_GetError() );
+      gt_stopExport( stats );
+      return F;
+   }
+   return T;
+}
@@ -0,0 +1,332 @@
+/*
+ *
+ */
+
+#include "gt_private.h"
+
+/* ------------------------------------------------------------------------- */
+// trace: spans are kept in a buffer of the thread that records them, without locking. A full buffer is queued
+// and a writer thread turns it into Chrome trace events, so the file is written off the threads being measured.
+#define GT_TRACE_EVENTS  1024  // spans per buffer
+#define GT_TRACE_THREADS 32
+#define GT_TRACE_DEPTH   32    // spans open at once on a thread, deeper ones are not recorded
+#define GT_TRACE_DETAIL  96
+
+typedef struct
+{
+   const char *name;
+   char        detail[ GT_TRACE_DETAIL ];
+   Uint64      begin;                      // SDL_GetPerformanceCounter()
+   Uint64      end;
+} GTTraceEvent;
+
+typedef struct _GTTraceBuffer
+{
+   struct _GTTraceBuffer *next;            // queue of full buffers
+   unsigned long          thread;
+   int                    count;
+   GTTraceEvent           events[ GT_TRACE_EVENTS ];
+} GTTraceBuffer;
+
+static SDL_atomic_t   gtTracing;           // 1 between gt_traceStart() and gt_traceStop()
+static int            gtTraceGeneration;   // a thread's buffer of an earlier trace is not used again
+static Uint64         gtTraceOrigin;       // counter at gt_traceStart(), timestamps start from it
+static FILE          *gtTraceFile;
+static bool           gtTraceFirst;        // no event written yet, for the commas between them
+static SDL_Thread    *gtTraceWriter;
+static SDL_sem       *gtTraceWake;         // posted per queued buffer
+static SDL_mutex     *gtTraceLock;         // guards everything below
+static GTTraceBuffer *gtTraceQueue;
+static GTTraceBuffer *gtTraceBuffers[ GT_TRACE_THREADS ];  // buffer each thread records into
+static int            gtTraceThreads;
+static bool           gtTraceQuit;
+static int            gtTraceDropped;      // spans lost to allocation failures or too many threads
+
+static _Thread_local struct
+{
+   int          generation;
+   int          slot;                      // in gtTraceBuffers, -1 when the thread is not traced
+   int          depth;
+   GTTraceEvent open[ GT_TRACE_DEPTH ];
+} gtThreadTrace;
+
+static GTTraceBuffer *gt_traceBuffer( void )
+{
+   GTTraceBuffer *buffer = malloc( sizeof( GTTraceBuffer ) );
+   if( buffer )
+   {
+      buffer->next   = NULL;
+      buffer->thread = SDL_ThreadID();
+      buffer->count  = 0;
+   }
+   return buffer;
+}
+
+// Called with gtTraceLock held
+static void gt_traceQueue( GTTraceBuffer *buffer )
+{
+   GTTraceBuffer **last = &gtTraceQueue;
+
+   while( *last )
+   {
+      last = &( *last )->next;
+   }
+   buffer->next = NULL;
+   *last = buffer;
+}
+
+// First span of the thread in this trace
+static void gt_traceAttach( void )
+{
+   gtThreadTrace.generation = gtTraceGeneration;
+   gtThreadTrace.slot       = -1;
+   gtThreadTrace.depth      = 0;
+
+   GTTraceBuffer *buffer = gt_traceBuffer();
+
+   SDL_LockMutex( gtTraceLock );
+   if( buffer && gtTraceThreads < GT_TRACE_THREADS )
+   {
+      gtThreadTrace.slot = gtTraceThreads;
+      gtTraceBuffers[ gtTraceThreads++ ] = buffer;
+      buffer = NULL;
+   }
+   else
+   {
+      gtTraceDropped++;
+   }
+   SDL_UnlockMutex( gtTraceLock );
+
+   free( buffer );
+}
+
+/* ------------------------------------------------------------------------- */
+// writer thread
+static void gt_traceWriteString( FILE *file, const char *string )
+{
+   fputc( '"', file );
+   for( const unsigned char *c = ( const unsigned char * ) string; *c; c++ )
+   {
+      if( *c == '"' || *c == '\\' )
+      {
+         fputc( '\\', file );
+         fputc( *c, file );
+      }
+      else if( *c < 0x20 )
+      {
+         fprintf( file, "\\u%04x", *c );
+      }
+      else
+      {
+         fputc( *c, file );
+      }
+   }
+   fputc( '"', file );
+}
+
+static void gt_traceWrite( GTTraceBuffer *buffer )
+{
+   double usPerTick = 1000000.0 / SDL_GetPerformanceFrequency();
+
+   for( int e = 0; e < buffer->count; e++ )
+   {
+      const GTTraceEvent *event = &buffer->events[ e ];
+
+      fprintf( gtTraceFile, "%s\n{\"name\":", gtTraceFirst ? "" : "," );
+      gt_traceWriteString( gtTraceFile, event->name );
+      fprintf( gtTraceFile, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%lu",
+               ( event->begin - gtTraceOrigin ) * usPerTick, ( event->end - event->begin ) * usPerTick,
+               gt_processId(), buffer->thread );
+      if( event->detail[ 0 ] )
+      {
+         fputs( ",\"args\":{\"detail\":", gtTraceFile );
+         gt_traceWriteString( gtTraceFile, event->detail );
+         fputc( '}', gtTraceFile );
+      }
+      fputc( '}', gtTraceFile );
+      gtTraceFirst = F;
+   }
+}
+
+static int gt_traceWriter( void *data )
+{
+   UNUSED( data );
+
+   for( ;; )
+   {
+      SDL_SemWait( gtTraceWake );
+
+      SDL_LockMutex( gtTraceLock );
+      GTTraceBuffer *buffer = gtTraceQueue;
+      gtTraceQueue = NULL;
+      bool quit = gtTraceQuit;
+      SDL_UnlockMutex( gtTraceLock );
+
+      while( buffer )
+      {
+         GTTraceBuffer *next = buffer->next;
+         gt_traceWrite( buffer );
+         free( buffer );
+         buffer = next;
+      }
+      if( quit )
+      {
+         return 0;
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------- */
+// Writes Chrome trace events to path until gt_traceStop(), GT_TRACE=/path.json starts it with the first window.
+// Open the file in chrome://tracing or ui.perfetto.dev.
+bool gt_traceStart( const char *path )
+{
+   if( SDL_AtomicGet( &gtTracing ) )
+   {
+      return T;
+   }
+
+   gtTraceFile   = fopen( path, "w" );
+   gtTraceWake   = SDL_CreateSemaphore( 0 );
+   gtTraceLock   = SDL_CreateMutex();
+   if( !gtTraceFile || !gtTraceWake || !gtTraceLock )
+   {
+      fprintf( stderr, "Unable to start tracing to %s\n", path );
+      gt_traceStop();
+      return F;
+   }
+
+   fputs( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", gtTraceFile );
+   gtTraceFirst   = T;
+   gtTraceQuit    = F;
+   gtTraceThreads = 0;
+   gtTraceDropped = 0;
+   gtTraceOrigin  = SDL_GetPerformanceCounter();
+   gtTraceGeneration++;
+
+   gtTraceWriter = SDL_CreateThread( gt_traceWriter, "gt trace", NULL );
+   if( !gtTraceWriter )
+   {
+      fprintf( stderr, "Unable to start the trace writer: %s\n", SDL_GetError() );
+      gt_traceStop();
+      return F;
+   }
+
+   SDL_AtomicSet( &gtTracing, 1 );
+   return T;
+}
+
+// Writes the spans still buffered and closes the file; the other threads must be done recording spans
+void gt_traceStop( void )
+{
+   SDL_AtomicSet( &gtTracing, 0 );
+
+   if( gtTraceWriter )
+   {
+      SDL_LockMutex( gtTraceLock );
+      for( int t = 0; t < gtTraceThreads; t++ )
+      {
+         gt_traceQueue( gtTraceBuffers[ t ] );
+         gtTraceBuffers[ t ] = NULL;
+      }
+      gtTraceThreads = 0;
+      gtTraceQuit = T;
+      SDL_UnlockMutex( gtTraceLock );
+
+      SDL_SemPost( gtTraceWake );
+      SDL_WaitThread( gtTraceWriter, NULL );
+      gtTraceWriter = NULL;
+
+      if( gtTraceDropped > 0 )
+      {
+         fprintf( stderr, "Tracing lost %d spans.\n", gtTraceDropped );
+      }
+   }
+   if( gtTraceFile )
+   {
+      fputs( "\n]}\n", gtTraceFile );
+      fclose( gtTraceFile );
+      gtTraceFile = NULL;
+   }
+   if( gtTraceWake )
+   {
+      SDL_DestroySemaphore( gtTraceWake );
+      gtTraceWake = NULL;
+   }
+   if( gtTraceLock )
+   {
+      SDL_DestroyMutex( gtTraceLock );
+      gtTraceLock = NULL;
+   }
+}
+
+// Opens a span on the calling thread; name has to outlive the trace, a string literal. detail may be NULL.
+void gt_traceBegin( const char *name, const char *detail )
+{
+   if( !SDL_AtomicGet( &gtTracing ) )
+   {
+      return;
+   }
+   if( gtThreadTrace.generation != gtTraceGeneration )
+   {
+      gt_traceAttach();
+   }
+
+   int depth = gtThreadTrace.depth++;
+   if( gtThreadTrace.slot < 0 || depth >= GT_TRACE_DEPTH )
+   {
+      return;
+   }
+
+   GTTraceEvent *event = &gtThreadTrace.open[ depth ];
+   event->name = name;
+   gt_safeCopyUtf8( event->detail, detail ? detail : "", sizeof( event->detail ) );
+   event->begin = SDL_GetPerformanceCounter();
+}
+
+// Closes the span the thread opened last
+void gt_traceEnd( void )
+{
+   Uint64 end = SDL_GetPerformanceCounter();
+
+   if( !SDL_AtomicGet( &gtTracing ) || gtThreadTrace.generation != gtTraceGeneration || gtThreadTrace.depth == 0 )
+   {
+      return;
+   }
+
+   int depth = --gtThreadTrace.depth;
+   if( gtThreadTrace.slot < 0 || depth >= GT_TRACE_DEPTH )
+   {
+      return;
+   }
+
+   GTTraceBuffer *buffer = gtTraceBuffers[ gtThreadTrace.slot ];
+   if( buffer->count == GT_TRACE_EVENTS )
+   {
+      // Handed to the writer, recording goes on in a fresh buffer
+      GTTraceBuffer *fresh = gt_traceBuffer();
+
+      SDL_LockMutex( gtTraceLock );
+      if( fresh )
+      {
+         gt_traceQueue( buffer );
+         gtTraceBuffers[ gtThreadTrace.slot ] = fresh;
+      }
+      else
+      {
+         gtTraceDropped += buffer->count;
+         buffer->count = 0;
+      }
+      SDL_UnlockMutex( gtTraceLock );
+
+      if( fresh )
+      {
+         SDL_SemPost( gtTraceWake );
+         buffer = fresh;
+      }
+   }
+
+   GTTraceEvent *event = &buffer->events[ buffer->count++ ];
+   *event = gtThreadTrace.open[ depth ];
+   event->end = end;
+}
@@ -0,0 +1,37 @@
+/*
+ *
+ */
+
+#include "gt.h"
+
+int main( int argc, char *argv[] )
+{
+   const char *path = IIF( argc > 1, argv[ 1 ], "headless.ppm" );
+
+   GT *gt = gt_createWindowEx( 830, 450, "Test headless", "F1F1F1", GT_RENDERER_HEADLESS );
+   if( !gt )
+   {
+      return 1;
+   }
+
+   gt_beginDraw( gt );
+
+      gt_dispBox( 0, 0, gt_maxCol( gt ), gt_maxRow( gt ), BOX_SINGLE, "F1F1F1/000000" );
+      gt_drawText( 2, 2, "Headless frame, no window and no OpenGL", "F1F1F1/000000" );
+      gt_drawText( 2, 4, "∮ E⋅da = Q,  n → ∞, ∑ f(i) = ∏ g(i)", "0000FF/FFFFFF" );
+      gt_drawText( 2, 6, "漢字テスト| wide characters take two cells", "F1F1F1/000000" );
+      gt_drawText( 2, 7, "e\u0301 n\u0303 o\u0308| combining marks take none", "F1F1F1/000000" );
+      gt_drawTextClipped( 2, 8, "日本語テキスト", 9, T, gt_hexColorPair( "000000/F1F1F1" ) );
+
+   gt_endDraw( gt );
+
+   if( !gt_saveFramePPM( gt, path ) )
+   {
+      gt_clearAll( gt );
+      return 1;
+   }
+   printf( "Frame %dx%d saved to %s\n", gt_maxWidth( gt ), gt_maxHeight( gt ), path );
+
+   gt_clearAll( gt );
+   return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ *
+ */
+
+#include "gt.h"
+
+// Switches to a font with the same cell size after the first frame; unchanged cells have to be drawn again,
+// so the frame must match one drawn with that font from the start.
+static const char *gtText[] =
+{
+   "Font switch, no window and no OpenGL",
+   "∮ E⋅da = Q,  n → ∞, ∑ f(i) = ∏ g(i)",
+   "┌─────┐ ÄÖÜ äöü ß",
+};
+
+static void draw( GT *gt )
+{
+   gt_beginDraw( gt );
+
+      for( size_t i = 0; i < LEN( gtText ); i++ )
+      {
+         gt_drawText( 2, 2 + 2 * ( int ) i, gtText[ i ], "000000/F1F1F1" );
+      }
+
+   gt_endDraw( gt );
+}
+
+static gt_color *readFrame( GT *gt )
+{
+   int size = gt_maxWidth( gt ) * gt_maxHeight( gt );
+   gt_color *pixels = malloc( sizeof( gt_color ) * size );
+
+   if( pixels && !gt_readPixels( gt, 0, 0, gt_maxWidth( gt ), gt_maxHeight( gt ), pixels ) )
+   {
+      free( pixels );
+      return NULL;
+   }
+   return pixels;
+}
+
+int main( void )
+{
+   // The built-in font with every glyph inverted, a different font of the same cell size
+   GTFont inverted = gtFontBuiltin;
+   Uint16 *glyphs = malloc( sizeof( Uint16 ) * gtFontBuiltin.glyphCount * gtFontBuiltin.height );
+   if( !glyphs )
+   {
+      return 1;
+   }
+   for( int i = 0; i < gtFontBuiltin.glyphCount * gtFontBuiltin.height; i++ )
+   {
+      glyphs[ i ] = ~gtFontBuiltin.glyphs[ i ] & ( Uint16 )( 0xFFFF << ( 16 - gtFontBuiltin.width ) );
+   }
+   inverted.glyphs = glyphs;
+
+   GT *switched = gt_createWindowEx( 400, 120, "Test font switch", "F1F1F1", GT_RENDERER_HEADLESS );
+   GT *reference = gt_createWindowEx( 400, 120, "Test font switch", "F1F1F1", GT_RENDERER_HEADLESS );
+   if( !switched || !reference )
+   {
+      return 1;
+   }
+
+   draw( switched );
+   gt_setFont( switched, &inverted );
+   draw( switched );
+
+   gt_setFont( reference, &inverted );
+   draw( reference );
+
+   gt_color *after    = readFrame( switched );
+   gt_color *expected = readFrame( reference );
+   bool same = after && expected &&
+               memcmp( after, expected, sizeof( gt_color ) * gt_maxWidth( switched ) * gt_maxHeight( switched ) ) == 0;
+
+   printf( "Frame after the font switch %s the reference\n", IIF( same, "matches", "differs from" ) );
+
+   free( after );
+   free( expected );
+   gt_clearAll( switched );
+   gt_clearAll( reference );
+   free( glyphs );
+   return IIF( same, 0, 1 );
+}
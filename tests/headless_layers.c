@@ -0,0 +1,116 @@
+/*
+ *
+ */
+
+#include "gt.h"
+
+// Scrolls a list while a layer is open over it, then closes the layer; the grid must not keep a copy of the layer,
+// so the frame must match one drawn with the list scrolled and no layer at all.
+#define LIST_ROWS 12
+#define LIST_COLS 24
+
+static void drawRow( int row, int top )
+{
+   char text[ 32 ];
+
+   snprintf( text, sizeof( text ), "line %d", top + row );
+   gt_drawTextClipped( 0, row, text, LIST_COLS, T, gt_hexColorPair( "000000/F1F1F1" ) );
+}
+
+static void drawList( int top )
+{
+   for( int row = 0; row < LIST_ROWS; row++ )
+   {
+      drawRow( row, top );
+   }
+}
+
+static gt_color *readFrame( GT *gt )
+{
+   int size = gt_maxWidth( gt ) * gt_maxHeight( gt );
+   gt_color *pixels = malloc( sizeof( gt_color ) * size );
+
+   if( pixels && !gt_readPixels( gt, 0, 0, gt_maxWidth( gt ), gt_maxHeight( gt ), pixels ) )
+   {
+      free( pixels );
+      return NULL;
+   }
+   return pixels;
+}
+
+// overlay: the scrolling frame starts with gt_beginOverlay() instead of gt_beginDraw()
+static bool scrollUnderLayer( GT *reference, bool overlay )
+{
+   GT *gt = gt_createWindowEx( 400, 300, "Test scroll under a layer", "F1F1F1", GT_RENDERER_HEADLESS );
+   if( !gt )
+   {
+      return F;
+   }
+
+   gt_beginDraw( gt );
+      drawList( 0 );
+   gt_endDraw( gt );
+
+   GTLayer *layer = gt_createLayer( gt, 2, 5, 8, 1, 1 );
+
+   gt_beginDraw( gt );
+      drawList( 0 );
+      gt_selectLayer( gt, layer );
+      gt_fillRect( 0, 0, 8, 1, '#', gt_hexColorPair( "FFFFFF/0000FF" ) );
+   gt_endDraw( gt );
+
+   // The list scrolls by one row, only the exposed row is drawn when the scroll succeeds
+   if( overlay )
+   {
+      gt_beginOverlay( gt );
+   }
+   else
+   {
+      gt_beginDraw( gt );
+   }
+      if( gt_scrollRegion( 0, 0, LIST_COLS, LIST_ROWS, -1 ) )
+      {
+         drawRow( LIST_ROWS - 1, 1 );
+      }
+      else
+      {
+         drawList( 1 );
+      }
+   gt_endDraw( gt );
+
+   gt_closeLayer( layer );
+   gt_beginOverlay( gt );
+   gt_endDraw( gt );
+
+   gt_color *after    = readFrame( gt );
+   gt_color *expected = readFrame( reference );
+   bool same = after && expected &&
+               memcmp( after, expected, sizeof( gt_color ) * gt_maxWidth( gt ) * gt_maxHeight( gt ) ) == 0;
+
+   printf( "Frame scrolled under a layer begun with %s %s the reference\n",
+           IIF( overlay, "gt_beginOverlay()", "gt_beginDraw()" ), IIF( same, "matches", "differs from" ) );
+
+   free( after );
+   free( expected );
+   gt_clearAll( gt );
+   return same;
+}
+
+int main( void )
+{
+   GT *reference = gt_createWindowEx( 400, 300, "Test scroll under a layer", "F1F1F1", GT_RENDERER_HEADLESS );
+   if( !reference )
+   {
+      return 1;
+   }
+
+   gt_beginDraw( reference );
+      drawList( 1 );
+   gt_endDraw( reference );
+
+   bool same = scrollUnderLayer( reference, F );
+   same = scrollUnderLayer( reference, T ) && same;
+
+   gt_clearAll( reference );
+   return IIF( same, 0, 1 );
+}
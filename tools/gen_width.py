@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+#
+# Generates src/unicode_width.c, the display width of every Unicode codepoint:
+#
+#    python3 tools/gen_width.py > src/unicode_width.c
+#
+# 0  combining marks, format characters and other zero-width codepoints
+# 2  East Asian Wide and Fullwidth characters
+# 1  everything else; control characters too, GT draws them with the replacement glyph
+#
+# The widths are stored two bits each in blocks of 256 codepoints, identical blocks once,
+# so gt_charWidth() is two table loads for any codepoint.
+
+import sys
+import unicodedata
+
+MAX_CODEPOINT = 0x110000
+
+# Unassigned codepoints in these ranges default to Wide, see EastAsianWidth.txt
+WIDE_RANGES = [
+   ( 0x3400, 0x4DBF ),
+   ( 0x4E00, 0x9FFF ),
+   ( 0xF900, 0xFAFF ),
+   ( 0x20000, 0x2FFFD ),
+   ( 0x30000, 0x3FFFD ),
+]
+
+# Prepended_Concatenation_Mark, drawn in front of the digits they span
+PREPENDED_MARKS = set( range( 0x0600, 0x0606 ) ) | { 0x06DD, 0x070F, 0x0890, 0x0891, 0x08E2, 0x110BD, 0x110CD }
+
+def width( codepoint ):
+   char = chr( codepoint )
+   category = unicodedata.category( char )
+
+   if codepoint == 0x00AD or codepoint in PREPENDED_MARKS:  # format characters that are visible
+      return 1
+   if category in ( 'Mn', 'Me', 'Cf' ):
+      return 0
+   if 0x1160 <= codepoint <= 0x11FF or 0xD7B0 <= codepoint <= 0xD7FF:  # Hangul medial vowels and final consonants
+      return 0
+   if codepoint == 0x200B:                      # zero width space
+      return 0
+   if unicodedata.east_asian_width( char ) in ( 'W', 'F' ):
+      return 2
+   if category == 'Cn' and any( first <= codepoint <= last for first, last in WIDE_RANGES ):
+      return 2
+   return 1
+
+def main():
+   blocks = []
+   blockIndex = {}
+   pages = []
+
+   for page in range( MAX_CODEPOINT >> 8 ):
+      packed = bytearray( 64 )
+      for i in range( 256 ):
+         packed[ i >> 2 ] |= width( ( page << 8 ) | i ) << ( ( i & 3 ) * 2 )
+      packed = bytes( packed )
+      if packed not in blockIndex:
+         blockIndex[ packed ] = len( blocks )
+         blocks.append( packed )
+      pages.append( blockIndex[ packed ] )
+
+   if len( blocks ) > 256:
+      sys.exit( 'too many distinct blocks for a Uint8 page table' )
+
+   out = sys.stdout
+   out.write( '/*\n' )
+   out.write( ' * Display width of every Unicode %s codepoint, generated by tools/gen_width.py - do not edit.\n' % unicodedata.unidata_version )
+   out.write( ' */\n\n' )
+   out.write( '#include "gt.h"\n\n' )
+   out.write( '#define WIDTH_BLOCKS %d\n\n' % len( blocks ) )
+
+   out.write( 'static const Uint8 gtWidthPage[ 0x110000 >> 8 ] = {\n' )
+   for row in range( 0, len( pages ), 16 ):
+      out.write( '   ' + ' '.join( '%3d,' % page for page in pages[ row:row + 16 ] ) + '\n' )
+   out.write( '};\n\n' )
+
+   # Two bits per codepoint, the lowest pair is the first codepoint of each byte
+   out.write( 'static const Uint8 gtWidthBlock[ WIDTH_BLOCKS ][ 64 ] = {\n' )
+   for packed in blocks:
+      out.write( '   {\n' )
+      for row in range( 0, 64, 16 ):
+         out.write( '      ' + ' '.join( '0x%02X,' % byte for byte in packed[ row:row + 16 ] ) + '\n' )
+      out.write( '   },\n' )
+   out.write( '};\n\n' )
+
+   out.write( '/* ------------------------------------------------------------------------- */\n' )
+   out.write( '// Number of cells a codepoint occupies: 0, 1 or 2\n' )
+   out.write( 'int gt_charWidth( unsigned int codepoint )\n' )
+   out.write( '{\n' )
+   out.write( '   if( codepoint >= 0x110000 )\n' )
+   out.write( '   {\n' )
+   out.write( '      return 1;\n' )
+   out.write( '   }\n' )
+   out.write( '   return ( gtWidthBlock[ gtWidthPage[ codepoint >> 8 ] ][ ( codepoint & 0xFF ) >> 2 ] >> ( ( codepoint & 3 ) * 2 ) ) & 3;\n' )
+   out.write( '}\n' )
+
+if __name__ == '__main__':
+   main()